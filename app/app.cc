@@ -5,13 +5,20 @@
 #include <SDL.h>
 #include <fmt/core.h>
 
-App::App(const Config& config) {
+#include "trace.h"
+
+App::App(const Config& config) : trace_path_(config.trace_path) {
   // Initialize SDL
   if (SDL_Init(SDL_INIT_VIDEO) < 0) {
     fmt::println(stderr, "Error initializing SDL: {}", SDL_GetError());
     return;  // is_running remains false
   }
 
+  // Optional: record a timeline of the frames.
+  if (!trace_path_.empty()) {
+    Trace::Enable(config.trace_events_per_thread);
+  }
+
   // Create systems
   window_ = std::make_unique<Window>(config.window_config);
 
@@ -23,8 +30,7 @@ App::App(const Config& config) {
   input_ = std::make_unique<Input>();
 
   if (window_->Ok() && renderer_->Ok()) {
-    // Construct texture with default configuration values.
-    texture_ = std::make_unique<Texture>(*renderer_);
+    texture_ = std::make_unique<Texture>(*renderer_, config.texture_config);
 
     // Resize Buffer: Width * Height, filled with Black (0)
     // 0xFF000000 is Black (Alpha=255), 0x00000000 is Transparent
@@ -35,7 +41,20 @@ App::App(const Config& config) {
   if (texture_->Ok()) {
     // Construct the world
     world_ =
-        std::make_unique<World>(texture_->GetWidth(), texture_->GetHeight());
+        std::make_unique<World>(texture_->GetWidth(), texture_->GetHeight(),
+                                config.world_layout);
+    history_ = std::make_unique<History>(config.history_config);
+
+    // Optional: stream metrics for unattended installations.
+    if (!config.metrics_config.path.empty()) {
+      metrics_ = std::make_unique<MetricsEmitter>(config.metrics_config);
+    }
+
+    // Optional: let external processes observe the world.
+    if (!config.publisher_config.name.empty()) {
+      publisher_ = std::make_unique<WorldPublisher>(
+          config.publisher_config, world_->GetWidth(), world_->GetHeight());
+    }
   }
 
   // Validation
@@ -44,6 +63,10 @@ App::App(const Config& config) {
 }
 
 App::~App() noexcept {
+  if (!trace_path_.empty()) {
+    Trace::Dump(trace_path_);
+  }
+
   // Destroy resources in REVERSE dependency order.
   // Texture depends on Renderer, destroy it first.
   texture_.reset();
@@ -56,6 +79,9 @@ App::~App() noexcept {
 
   // Input and world are independent, but good to clean up.
   input_.reset();
+  history_.reset();
+  publisher_.reset();
+  metrics_.reset();
   world_.reset();
 
   // `SDL_Quit()` must be the very last thing called
@@ -70,8 +96,15 @@ int App::Run() {
   double dt{0.0};
   float fps_timer = 0.0f;
   uint32_t frame_count = 0;
+  // Summed over the frames of the title update
+  double lock_wait_ms = 0.0;
+  double unlock_ms = 0.0;
+  uint32_t render_count = 0;
 
   while (is_running_) {
+    TRACE_SCOPE("Frame");
+    const uint64_t frame_start = SDL_GetPerformanceCounter();
+
     uint64_t current_time = SDL_GetTicks64();
     uint64_t frame_time = current_time - last_time;
     last_time = current_time;
@@ -85,30 +118,86 @@ int App::Run() {
           "Brush Size: " + std::to_string(brush_size_) +
           "   Sand Count: " + std::to_string(world_->GetSandCount()) +
           "   FPS: " +
-          std::to_string(static_cast<int32_t>(frame_count * (1 / fps_timer)));
+          std::to_string(static_cast<int32_t>(frame_count * (1 / fps_timer))) +
+          fmt::format("   Lock: {:.2f} ms   Unlock: {:.2f} ms",
+                      render_count ? lock_wait_ms / render_count : 0.0,
+                      render_count ? unlock_ms / render_count : 0.0) +
+          (is_paused_ ? "   (Paused)" : "") + (is_idle_ ? "   (Idle)" : "");
       SDL_SetWindowTitle(window_->Get(), title.c_str());
 
       frame_count = 0;
       fps_timer = 0.0f;
+      lock_wait_ms = 0.0;
+      unlock_ms = 0.0;
+      render_count = 0;
     }
 
     PollEvents();
     Update(frame_count);
-    Render();
+
+    // Nothing moved and no input: keep the last frame on screen and
+    // sleep in the next `PollEvents()` until something happens.
+    is_idle_ = !needs_render_ && !input_->IsMouseButtonDown(SDL_BUTTON_LEFT) &&
+               !input_->IsMouseButtonDown(SDL_BUTTON_RIGHT);
+
+    const bool rendered = needs_render_;
+    if (needs_render_) {
+      Render();
+      needs_render_ = false;
+
+      lock_wait_ms += texture_->GetLockWaitMs();
+      unlock_ms += texture_->GetUnlockMs();
+      render_count++;
+    }
+
+    if (metrics_) {
+      metrics_->Record({
+          // The idle wait is not part of the cost of the frame.
+          .frame_ms = double(SDL_GetPerformanceCounter() - frame_start) *
+                          1000.0 / double(SDL_GetPerformanceFrequency()) -
+                      idle_ms_,
+          .step_ms = step_ms_,
+          .idle_ms = idle_ms_,
+          .sand_count = world_->GetSandCount(),
+          .active_regions = world_->GetActiveRegionCount(),
+          .upload_bytes = rendered ? texture_->GetUploadBytes() : 0,
+      });
+    }
   }
   return 0;
 }
 
 void App::PollEvents() {
+  TRACE_SCOPE("App::PollEvents");
   input_->BeginFrame();
   SDL_Event event;
-  while (SDL_PollEvent(&event)) {
+
+  // When idle, block until the first event arrives (the timeout keeps the
+  // title up to date). Otherwise just drain the queue.
+  bool has_event = false;
+  idle_ms_ = 0.0;
+  if (is_idle_) {
+    TRACE_SCOPE("App::Idle");
+    const uint64_t idle_start = SDL_GetPerformanceCounter();
+    has_event = SDL_WaitEventTimeout(&event, IDLE_TIMEOUT_MS) == 1;
+    idle_ms_ = double(SDL_GetPerformanceCounter() - idle_start) * 1000.0 /
+               double(SDL_GetPerformanceFrequency());
+  } else {
+    has_event = SDL_PollEvent(&event);
+  }
+
+  while (has_event) {
     // Feed the event to the input system
     input_->ProcessEvent(event);
+
+    // Any input (keys, mouse, window) may change what is on screen.
+    needs_render_ = true;
+    has_event = SDL_PollEvent(&event);
   }
 }
 
 void App::Update(uint32_t frame_count) {
+  TRACE_SCOPE("App::Update");
 
   // --- Quit logic
   if (input_->QuitRequested()) {
@@ -118,9 +207,26 @@ void App::Update(uint32_t frame_count) {
     is_running_ = false;
   }
 
+  // --- Write the trace so far
+  if (!trace_path_.empty() && input_->IsKeyPressed(SDL_SCANCODE_F9)) {
+    Trace::Dump(trace_path_);
+  }
+
   // Checks the mouse scroll wheel and updates the brush size.
   ModifyBrushSize();
 
+  // --- Pause and time travel
+  HandleHistory();
+
+  // --- Brush strokes start and end at a history boundary (the last saved
+  // step is the state right before / after the stroke).
+  const bool is_drawing = input_->IsMouseButtonDown(SDL_BUTTON_LEFT) ||
+                          input_->IsMouseButtonDown(SDL_BUTTON_RIGHT);
+  if (is_drawing != is_drawing_) {
+    history_->MarkBoundary();
+    is_drawing_ = is_drawing;
+  }
+
   // --- Spawn sand with left mouse button
   if (input_->IsMouseButtonDown(SDL_BUTTON_LEFT)) {
     SpawnSand(frame_count);
@@ -131,19 +237,46 @@ void App::Update(uint32_t frame_count) {
   }
 
   // --- Run the simulation step
-  world_->Update(frame_count);
+  step_ms_ = 0.0;
+  if (!is_paused_) {
+    const uint64_t step_start = SDL_GetPerformanceCounter();
+
+    // Redraw only if something moved.
+    if (world_->Update(frame_count) > 0) {
+      needs_render_ = true;
+    }
+    step_count_++;
+
+    step_ms_ = double(SDL_GetPerformanceCounter() - step_start) * 1000.0 /
+               double(SDL_GetPerformanceFrequency());
+  }
+
+  // --- Record the step (unchanged steps are not stored)
+  // A stored step means the brush changed the world.
+  if (history_->Save(world_.get())) {
+    needs_render_ = true;
+  }
+
+  // --- Export the frame to the observers
+  if (publisher_) {
+    publisher_->Publish(*world_, step_count_);
+  }
 }
 
 void App::Render() {
+  TRACE_SCOPE("App::Render");
   renderer_->Clear();
 
-  // Convert world cells to pixel colors.
-  const auto& cells = world_->GetCells();
+  // Convert world cells to pixel colors (run by run, the storage is padded).
+  const int32_t width = world_->GetWidth();
+  world_->ForEachRun([&](int32_t x, int32_t y, auto cells) {
+    uint32_t* pixels = pixel_buffer_.data() + size_t(y) * width + x;
 
-  // Iterate through every cell.
-  for (size_t i = 0; i < cells.size(); ++i) {
-    pixel_buffer_[i] = World::kColorTable[int32_t(cells[i])];
-  }
+    // Iterate through every cell.
+    for (size_t i = 0; i < cells.size(); ++i) {
+      pixels[i] = World::kColorTable[int32_t(cells[i])];
+    }
+  });
 
   // Upload and draw.
   texture_->Update(pixel_buffer_);
@@ -193,6 +326,33 @@ void App::ModifyBrushSize() {
     brush_size_ = MAX_BRUSH_SIZE;
 }
 
+void App::HandleHistory() {
+  if (input_->IsKeyPressed(SDL_SCANCODE_SPACE)) {
+    is_paused_ = !is_paused_;
+  }
+
+  const bool ctrl_down = input_->IsKeyDown(SDL_SCANCODE_LCTRL) ||
+                         input_->IsKeyDown(SDL_SCANCODE_RCTRL);
+
+  bool moved = false;
+  if (ctrl_down && input_->IsKeyPressed(SDL_SCANCODE_Z)) {
+    moved |= history_->UndoToBoundary(world_.get());
+  }
+  if (ctrl_down && input_->IsKeyPressed(SDL_SCANCODE_Y)) {
+    moved |= history_->RedoToBoundary(world_.get());
+  }
+  if (input_->IsKeyPressed(SDL_SCANCODE_BACKSPACE)) {
+    moved |= history_->Rewind(world_.get(), REWIND_STEPS) > 0;
+  }
+
+  // Keep the restored step on screen, a running simulation would save the
+  // next step right away and drop the redo steps.
+  if (moved) {
+    is_paused_ = true;
+    needs_render_ = true;
+  }
+}
+
 void App::Draw(World::CellType type, int32_t world_x, int32_t world_y) {
   // Simple brush
   for (int y = -brush_size_; y <= brush_size_; ++y) {
@@ -4,10 +4,15 @@
 #define SDL2_SAND_SIMULATION_APP_APP_H_
 
 #include <memory>
+#include <string>
 
+#include "history.h"
 #include "input.h"
+#include "metrics.h"
 #include "renderer.h"
+#include "shared_world.h"
 #include "texture.h"
+#include "trace.h"
 #include "window.h"
 #include "world.h"
 
@@ -19,6 +24,18 @@ class App {
   struct Config {
     Window::Config window_config;
     Renderer::Config renderer_config;
+    Texture::Config texture_config;
+    History::Config history_config;
+    World::Layout world_layout = World::Layout::kRows;
+    // Leave the name empty to disable the shared memory export.
+    WorldPublisher::Config publisher_config;
+    // Leave the path empty to disable the metrics stream.
+    MetricsEmitter::Config metrics_config;
+    // Leave the path empty to disable tracing.
+    // The trace is written on exit and when F9 is pressed.
+    std::string trace_path;
+    // Most recent events kept per thread (older ones are overwritten).
+    size_t trace_events_per_thread = Trace::kDefaultEventsPerThread;
   };
 
   // Constructor with default configuration values
@@ -48,6 +65,11 @@ class App {
   void DestroySand(uint32_t frame_count);
   void ModifyBrushSize();
 
+  // Handles pause, undo (Ctrl+Z), redo (Ctrl+Y) and rewind (Backspace).
+  // Undo and redo move by whole brush strokes. Moving through the history
+  // pauses the simulation (the next step would record a new branch).
+  void HandleHistory();
+
   // Uses brush to draw cells.
   void Draw(World::CellType type, int32_t x, int32_t y);
 
@@ -59,7 +81,31 @@ class App {
   std::unique_ptr<Texture> texture_;
   std::unique_ptr<Input> input_;
   std::unique_ptr<World> world_;
-  
+  std::unique_ptr<History> history_;
+  std::unique_ptr<WorldPublisher> publisher_;
+  std::unique_ptr<MetricsEmitter> metrics_;
+
+  // Number of saved steps a single rewind goes back.
+  const int32_t REWIND_STEPS = 60;
+  bool is_paused_{false};
+  // A mouse button was held in the last frame (a brush stroke is running).
+  bool is_drawing_{false};
+
+  // Idle (low power) mode: the world is quiescent and there is no input.
+  // Sleeps at most this long per frame while idle.
+  const int32_t IDLE_TIMEOUT_MS = 250;
+  bool is_idle_{false};
+  bool needs_render_{true};
+
+  std::string trace_path_;
+
+  // Number of simulation steps run so far.
+  uint64_t step_count_{0};
+  // Duration of the last simulation step.
+  double step_ms_{0.0};
+  // Time the last `PollEvents()` slept waiting for events.
+  double idle_ms_{0.0};
+
   const int32_t MIN_BRUSH_SIZE = 2;
   const int32_t MAX_BRUSH_SIZE = 256;
   int32_t brush_size_{32};
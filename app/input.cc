@@ -67,6 +67,10 @@ bool Input::IsKeyReleased(SDL_Scancode scan_code) const {
   return false;
 }
 
+bool Input::IsKeyDown(SDL_Scancode scan_code) const {
+  return keyboard_state_ && keyboard_state_[scan_code];
+}
+
 bool Input::IsMouseButtonDown(uint8_t button) const {
   const uint32_t mask = SDL_GetMouseState(nullptr, nullptr);
   return (mask & SDL_BUTTON(button));
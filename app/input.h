@@ -26,6 +26,9 @@ class Input {
   bool IsKeyPressed(SDL_Scancode scan_code) const;
   bool IsKeyReleased(SDL_Scancode scan_code) const;
 
+  // Checks if a key is HELD down.
+  bool IsKeyDown(SDL_Scancode scan_code) const;
+
   // Cheks if a mouse button is HELD down.
   bool IsMouseButtonDown(uint8_t button) const;
   void GetMousePosition(int32_t* x_out, int32_t* y_out) const;
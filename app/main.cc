@@ -1,9 +1,39 @@
 // MIT License
 
+#include <cstdlib>
+#include <string>
+
 #include "app.h"
 
 int main(int argc, char* argv[]) {
-  // Run App with default configuration
-  App app;
+  // Default configuration values
+  App::Config config;
+
+  // Optional features (disabled by default):
+  // --shm <name>   Export the world into a shared memory segment.
+  // --trace <file> Record a Chrome trace (written on exit and on F9).
+  // --tiles        Store the world in 64x64 tiles instead of rows.
+  // --ring <n>     Number of streaming textures (default 2).
+  // --metrics <path>          Stream metrics as JSON lines to a file
+  //                           (or "unix:<socket path>").
+  // --metrics-interval <sec>  Aggregation interval (default 1).
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--shm" && i + 1 < argc) {
+      config.publisher_config.name = argv[++i];
+    } else if (arg == "--trace" && i + 1 < argc) {
+      config.trace_path = argv[++i];
+    } else if (arg == "--tiles") {
+      config.world_layout = World::Layout::kTiles;
+    } else if (arg == "--ring" && i + 1 < argc) {
+      config.texture_config.ring_size = std::atoi(argv[++i]);
+    } else if (arg == "--metrics" && i + 1 < argc) {
+      config.metrics_config.path = argv[++i];
+    } else if (arg == "--metrics-interval" && i + 1 < argc) {
+      config.metrics_config.interval_seconds = std::atof(argv[++i]);
+    }
+  }
+
+  App app(config);
   return app.Run();
 }
\ No newline at end of file
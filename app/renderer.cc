@@ -6,6 +6,8 @@
 
 #include <fmt/core.h>
 
+#include "trace.h"
+
 Renderer::Renderer(const Window& window, const Config& config) {
   renderer_ = SDL_CreateRenderer(window.Get(), config.index, config.flags);
   if (!renderer_) {
@@ -51,5 +53,6 @@ void Renderer::RenderFrame(SDL_Texture* texture) {
   SDL_RenderCopy(renderer_, texture, nullptr, nullptr);
 }
 void Renderer::Present() {
+  TRACE_SCOPE("Renderer::Present");
   SDL_RenderPresent(renderer_);
 }
\ No newline at end of file
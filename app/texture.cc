@@ -2,66 +2,93 @@
 
 #include "texture.h"
 
+#include <algorithm>
 #include <utility>
 
 #include <fmt/core.h>
 
 #include "renderer.h"
+#include "trace.h"
 
 Texture::Texture(const Renderer& renderer) : Texture(renderer, Config{}) {}
 
 Texture::Texture(const Renderer& renderer, const Config& config)
     : width_(config.width), height_(config.height) {
 
-  texture_ = SDL_CreateTexture(renderer.Get(), config.format, config.access,
-                               config.width, config.height);
-  if (!texture_) {
-    fmt::println(stderr, "Error creating texture: {}", SDL_GetError());
-  } else {
-    SDL_SetTextureBlendMode(texture_, config.blend);
+  for (int32_t i = 0; i < std::max(config.ring_size, 1); ++i) {
+    SDL_Texture* texture =
+        SDL_CreateTexture(renderer.Get(), config.format, config.access,
+                          config.width, config.height);
+    if (!texture) {
+      fmt::println(stderr, "Error creating texture: {}", SDL_GetError());
+      // All or nothing, `Ok()` reports false.
+      Destroy();
+      return;
+    }
+    SDL_SetTextureBlendMode(texture, config.blend);
+    textures_.push_back(texture);
   }
 }
 
 Texture::~Texture() noexcept {
-  if (texture_) {
-    SDL_DestroyTexture(texture_);
-  }
+  Destroy();
 }
 
 // Moves Constructor
 Texture::Texture(Texture&& other) noexcept
-    : texture_(std::exchange(other.texture_, nullptr)),
+    : textures_(std::exchange(other.textures_, {})),
+      current_(other.current_),
       width_(other.width_),
-      height_(other.height_) {}
+      height_(other.height_),
+      lock_wait_ms_(other.lock_wait_ms_),
+      unlock_ms_(other.unlock_ms_),
+      upload_bytes_(other.upload_bytes_) {}
 
 // Move Assignment
 Texture& Texture::operator=(Texture&& other) noexcept {
   if (this != &other) {
     // Free current resources
-    if (texture_) {
-      SDL_DestroyTexture(texture_);
-    }
+    Destroy();
 
     // Acquire new resources
-    texture_ = std::exchange(other.texture_, nullptr);
+    textures_ = std::exchange(other.textures_, {});
+    current_ = other.current_;
     width_ = other.width_;
     height_ = other.height_;
+    lock_wait_ms_ = other.lock_wait_ms_;
+    unlock_ms_ = other.unlock_ms_;
+    upload_bytes_ = other.upload_bytes_;
   }
   return *this;
 }
 
 // Takes an array of CPU pixels and uploads them to the GPU. 
 void Texture::Update(const std::vector<uint32_t>& buffer) {
-  if (!texture_)
+  TRACE_SCOPE("Texture::Update");
+  if (!Ok())
     return;
 
+  // Write the oldest texture of the ring, the newer ones may still be in use.
+  const size_t next = (current_ + 1) % textures_.size();
+  SDL_Texture* texture = textures_[next];
+
   void* pixels;
   int pitch;
 
   //  Lock the texture to get write access to the GPU memory.
   // 'pitch' will return the width of one row in bytes (including padding).
-  if (SDL_LockTexture(texture_, nullptr, &pixels, &pitch) != 0)
+  // Backends that map the texture directly stall here while the GPU still
+  // reads it.
+  const double ms_per_tick = 1000.0 / double(SDL_GetPerformanceFrequency());
+  const uint64_t lock_start = SDL_GetPerformanceCounter();
+  const int lock_result = SDL_LockTexture(texture, nullptr, &pixels, &pitch);
+  lock_wait_ms_ =
+      double(SDL_GetPerformanceCounter() - lock_start) * ms_per_tick;
+  if (lock_result != 0) {
+    unlock_ms_ = 0.0;
+    upload_bytes_ = 0;
     return;  // Lock failed.
+  }
 
   // Cast void* pixels to uint8_t* for byte-level pointer arithmetics.
   uint8_t* const dest_ptr = static_cast<uint8_t*>(pixels);
@@ -81,5 +108,19 @@ void Texture::Update(const std::vector<uint32_t>& buffer) {
   }
 
   // Unlock and upload changes to GPU;
-  SDL_UnlockTexture(texture_);
+  // Backends with a staging buffer (e.g. OpenGL) upload and stall here.
+  const uint64_t unlock_start = SDL_GetPerformanceCounter();
+  SDL_UnlockTexture(texture);
+  unlock_ms_ = double(SDL_GetPerformanceCounter() - unlock_start) * ms_per_tick;
+  upload_bytes_ = uint64_t(row_byte_size) * height_;
+
+  // The new frame is ready to be presented.
+  current_ = next;
+}
+
+void Texture::Destroy() noexcept {
+  for (SDL_Texture* texture : textures_) {
+    SDL_DestroyTexture(texture);
+  }
+  textures_.clear();
 }
\ No newline at end of file
@@ -15,8 +15,10 @@ class Renderer;
 // Wrapper class for SDL_Texture (handles its own memory).
 // Provides default configuration values.
 // Provides a method to `Update()` the underlying texture.
+// Manages a ring of streaming textures: every `Update()` writes the next one,
+// so the upload does not wait for the GPU to finish with the previous frame.
 // Make sure to use `Ok()` to check if the creation is successful.
-// Use `Get()` to receive the underlying raw pointer.
+// Use `Get()` to receive the underlying raw pointer (the latest frame).
 class Texture {
  public:
   struct Config {
@@ -31,6 +33,9 @@ class Texture {
 
     // Blend mode is NONE to preserve raw pixel information (no blur).
     SDL_BlendMode blend = SDL_BLENDMODE_NONE;
+
+    // Number of textures in the ring (1 disables the ring, 2-3 is typical).
+    int32_t ring_size = 2;
   };
 
   // Constructor with default configuration values.
@@ -48,17 +53,34 @@ class Texture {
   Texture& operator=(Texture&&) noexcept;
 
   // Takes a flat buffer of pixels (width * height) and uploads it to GPU
+  // (into the next texture of the ring).
   void Update(const std::vector<uint32_t>& buffer);
 
-  bool Ok() const { return texture_ != nullptr; }
-  SDL_Texture* Get() const { return texture_; }
+  bool Ok() const { return !textures_.empty(); }
+  SDL_Texture* Get() const { return Ok() ? textures_[current_] : nullptr; }
   uint32_t GetWidth() const { return width_; }
   uint32_t GetHeight() const { return height_; }
+  int32_t GetRingSize() const { return int32_t(textures_.size()); }
+
+  // Time spent in `SDL_LockTexture()` / `SDL_UnlockTexture()` during the
+  // last `Update()`. Depending on the backend the upload (and the wait for
+  // the GPU) happens in either of them, evaluate the ring with the sum.
+  double GetLockWaitMs() const { return lock_wait_ms_; }
+  double GetUnlockMs() const { return unlock_ms_; }
+  // Bytes copied to the GPU by the last `Update()`.
+  uint64_t GetUploadBytes() const { return upload_bytes_; }
 
  private:
-  SDL_Texture* texture_{nullptr};
+  void Destroy() noexcept;
+
+  std::vector<SDL_Texture*> textures_;
+  // Index of the texture that holds the latest frame.
+  size_t current_{0};
   uint32_t width_{0};
   uint32_t height_{0};
+  double lock_wait_ms_{0.0};
+  double unlock_ms_{0.0};
+  uint64_t upload_bytes_{0};
 };
 
 #endif  // SDL2_SAND_SIMULATION_APP_TEXTURE_H_
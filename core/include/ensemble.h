@@ -0,0 +1,74 @@
+// MIT License
+
+#ifndef SDL2_SAND_SIMULATION_CORE_SRC_ENSEMBLE_H_
+#define SDL2_SAND_SIMULATION_CORE_SRC_ENSEMBLE_H_
+
+#include <cstdint>
+
+#include <functional>
+#include <vector>
+
+#include "world.h"
+
+// Headless runner for many small independent worlds (parameter sweeps,
+// statistics). Every world is stepped until it settles (or `max_steps`),
+// the worlds are spread over the cores with work stealing.
+// Usage:
+// Pass a `SetupFn` to `Run()`, it fills the world with the given index.
+// Read the per-world metrics and the throughput from the returned `Stats`.
+class Ensemble {
+ public:
+  // Default configuration values, can be overriden in the contructor
+  struct Config {
+    int32_t world_count = 256;
+    int32_t width = 256;
+    int32_t height = 256;
+    World::Layout layout = World::Layout::kRows;
+
+    // Worlds that still move after this many steps count as not settled.
+    int32_t max_steps = 10'000;
+
+    // 0 uses every hardware thread.
+    int32_t thread_count = 0;
+  };
+
+  // Metrics of a single world.
+  struct Result {
+    int32_t index = 0;
+    // Steps run (including the final step that moved nothing).
+    int32_t steps = 0;
+    bool settled = false;
+    uint64_t moved_cells = 0;
+    uint64_t sand_count = 0;
+  };
+
+  struct Stats {
+    std::vector<Result> results;  // Ordered by world index.
+    uint64_t world_steps = 0;
+    double seconds = 0.0;
+
+    double GetStepsPerSecond() const {
+      return seconds > 0.0 ? world_steps / seconds : 0.0;
+    }
+  };
+
+  // Fills the world with the given index (e.g. seeded scenario).
+  using SetupFn = std::function<void(World* world, int32_t index)>;
+
+  // Constructor with default configuration values
+  Ensemble() : Ensemble(Config{}) {}
+
+  explicit Ensemble(const Config&);
+
+  // Creates, steps and measures every world. Blocks until all are done.
+  // `setup` is called from the worker threads.
+  Stats Run(const SetupFn& setup) const;
+
+  int32_t GetThreadCount() const { return thread_count_; }
+
+ private:
+  Config config_;
+  int32_t thread_count_;
+};
+
+#endif  // SDL2_SAND_SIMULATION_CORE_SRC_ENSEMBLE_H_
@@ -0,0 +1,94 @@
+// MIT License
+
+#ifndef SDL2_SAND_SIMULATION_CORE_SRC_HISTORY_H_
+#define SDL2_SAND_SIMULATION_CORE_SRC_HISTORY_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "world.h"
+
+// Undo / redo buffer for a `World`.
+// Every snapshot splits the world cells into fixed size chunks.
+// Chunks are reference-counted and shared between snapshots (copy-on-write),
+// so a saved step only costs the chunks that actually changed.
+// Usage:
+// Call `Save()` after the world has been modified (e.g. once per frame).
+// Only the chunks the world reports as dirty are compared, so always save
+// the same world (its dirty flags are cleared by `Save()`).
+// Call `Undo()`, `Redo()` or `Rewind()` to move through the saved steps.
+// Call `MarkBoundary()` between user actions (e.g. brush strokes) and
+// `UndoToBoundary()` / `RedoToBoundary()` to undo them as a whole.
+class History {
+ public:
+  // Default configuration values, can be overriden in the contructor
+  struct Config {
+    // Number of cells stored in a single chunk.
+    size_t chunk_size = 16 * 1024;
+
+    // Upper bound of the memory held by the snapshots (in bytes).
+    // The oldest snapshots are dropped first when the limit is exceeded.
+    size_t memory_limit = 64 * 1024 * 1024;
+  };
+
+  // Constructor with default configuration values
+  History() : History(Config{}) {}
+
+  explicit History(const Config&);
+
+  // Stores the current state of the world.
+  // Discards the redo steps (if there are any).
+  // Returns false (and stores nothing) if the world did not change.
+  // Clears the dirty flags of the world.
+  bool Save(World* world);
+
+  // Restores the previous / next saved step.
+  // Returns false if there is no step to move to.
+  bool Undo(World* world);
+  bool Redo(World* world);
+
+  // Moves back by (at most) `steps` saved steps at once.
+  // Returns the number of steps actually rewound.
+  int32_t Rewind(World* world, int32_t steps);
+
+  // Marks the current step as a boundary (does nothing before the first
+  // `Save()`).
+  void MarkBoundary();
+
+  // Moves to the closest boundary before / after the current step
+  // (the oldest / newest step if there is none).
+  // Returns false if there is no step to move to.
+  bool UndoToBoundary(World* world);
+  bool RedoToBoundary(World* world);
+
+  // Drops every saved step.
+  void Clear();
+
+  size_t GetUndoCount() const { return snapshots_.empty() ? 0 : cursor_; }
+  size_t GetRedoCount() const;
+  size_t GetMemoryUsage() const { return memory_usage_; }
+
+ private:
+  using Chunk = std::shared_ptr<const std::vector<World::CellType>>;
+  using Snapshot = std::vector<Chunk>;
+
+  // Writes only the chunks that differ from the current world state.
+  void Restore(World* world, const Snapshot& snapshot) const;
+
+  // Subtracts the memory that is owned only by this snapshot.
+  void Release(const Snapshot& snapshot);
+
+  Config config_;
+  std::deque<Snapshot> snapshots_;
+  // Whether the snapshot with the same index is a boundary.
+  std::deque<bool> boundaries_;
+  // Index of the snapshot matching the current state of the world.
+  size_t cursor_{0};
+  size_t memory_usage_{0};
+};
+
+#endif  // SDL2_SAND_SIMULATION_CORE_SRC_HISTORY_H_
@@ -0,0 +1,87 @@
+// MIT License
+
+#ifndef SDL2_SAND_SIMULATION_CORE_SRC_METRICS_H_
+#define SDL2_SAND_SIMULATION_CORE_SRC_METRICS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include <array>
+#include <chrono>
+#include <string>
+
+// Opt-in metrics stream for unattended installations.
+// Aggregates per-frame samples over an interval and writes one line of JSON
+// (newline-delimited) per interval to a file or a Unix domain socket.
+// Recording and emitting never allocate (fixed buffers sized up front),
+// a socket that can not keep up drops records instead of blocking the frame.
+// Make sure to use `Ok()` to check if the output could be opened.
+class MetricsEmitter {
+ public:
+  // Default configuration values, can be overriden in the contructor
+  struct Config {
+    // A file path (appended to), or "unix:<path>" for a Unix domain socket
+    // (stream socket, POSIX only). Empty disables the metrics.
+    std::string path;
+    // Length of the aggregation interval (0 emits every frame).
+    double interval_seconds = 1.0;
+  };
+
+  // Values measured during a single frame.
+  struct Sample {
+    // Time spent working on the frame (without `idle_ms`).
+    double frame_ms = 0.0;
+    double step_ms = 0.0;
+    // Time spent sleeping while waiting for events (kept out of the
+    // frame time percentiles).
+    double idle_ms = 0.0;
+    uint64_t sand_count = 0;
+    int32_t active_regions = 0;
+    uint64_t upload_bytes = 0;
+  };
+
+  // Frame times kept per interval for the percentiles (the most recent ones).
+  static constexpr size_t kMaxSamples = 4096;
+
+  explicit MetricsEmitter(const Config&);
+  ~MetricsEmitter() noexcept;
+
+  // Disallow copies and moves (owns the output and large buffers)
+  MetricsEmitter(const MetricsEmitter&) = delete;
+  MetricsEmitter& operator=(const MetricsEmitter&) = delete;
+  MetricsEmitter(MetricsEmitter&&) = delete;
+  MetricsEmitter& operator=(MetricsEmitter&&) = delete;
+
+  // Adds a frame, emits a record once the interval has elapsed.
+  void Record(const Sample& sample);
+
+  // Emits the frames recorded so far (if any) and starts a new interval.
+  void Flush();
+
+  bool Ok() const { return file_ != nullptr || socket_ >= 0; }
+
+ private:
+  void Write(const char* data, size_t size);
+
+  std::FILE* file_{nullptr};
+  int socket_{-1};
+  std::chrono::duration<double> interval_;
+  std::chrono::steady_clock::time_point interval_start_;
+
+  // Aggregates of the current interval.
+  std::array<float, kMaxSamples> frame_ms_{};
+  uint64_t frames_{0};
+  double frame_ms_max_{0.0};
+  double step_ms_sum_{0.0};
+  double step_ms_max_{0.0};
+  double idle_ms_sum_{0.0};
+  uint64_t idle_frames_{0};
+  uint64_t upload_bytes_{0};
+  Sample last_{};
+
+  // Output line, formatted in place.
+  std::array<char, 512> line_{};
+};
+
+#endif  // SDL2_SAND_SIMULATION_CORE_SRC_METRICS_H_
@@ -0,0 +1,109 @@
+// MIT License
+
+#ifndef SDL2_SAND_SIMULATION_CORE_SRC_SHARED_WORLD_H_
+#define SDL2_SAND_SIMULATION_CORE_SRC_SHARED_WORLD_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "world.h"
+
+// Layout of the shared memory segment.
+// The header is followed by `width * height` cells (row-major, one byte each).
+// `magic` is stored last (release), the rest of the header is valid once an
+// observer loads it (acquire).
+// `sequence` is a seqlock: it is odd while the publisher is writing a frame.
+struct SharedWorldHeader {
+  static constexpr uint32_t kMagic = 0x53'41'4E'44;  // "SAND"
+  static constexpr uint32_t kVersion = 1;
+
+  std::atomic<uint32_t> magic;
+  uint32_t version;
+  int32_t width;
+  int32_t height;
+  std::atomic<uint64_t> sequence;
+  std::atomic<uint64_t> step;
+};
+
+// The atomics are shared between processes, they must not use locks.
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+// Publishes copies of a `World` into a named POSIX shared memory segment.
+// Local processes can map the segment (see `WorldObserver`) and read
+// consistent frames without ever blocking the simulation thread.
+// Make sure to use `Ok()` to check if the creation is successful.
+// (Not available on non-POSIX platforms, `Ok()` always returns false there.)
+class WorldPublisher {
+ public:
+  // Default configuration values, can be overriden in the contructor
+  struct Config {
+    // Name of the segment (e.g. "/sand_world"), empty disables publishing.
+    std::string name;
+    // Publish every N-th call to `Publish()` (1 = every frame).
+    uint32_t interval = 1;
+  };
+
+  // Creates (or replaces) the segment for a world of the given size.
+  WorldPublisher(const Config&, int32_t width, int32_t height);
+  ~WorldPublisher() noexcept;
+
+  // Disallow copies
+  WorldPublisher(const WorldPublisher&) = delete;
+  WorldPublisher& operator=(const WorldPublisher&) = delete;
+
+  // Allow moves
+  WorldPublisher(WorldPublisher&&) noexcept;
+  WorldPublisher& operator=(WorldPublisher&&) noexcept;
+
+  // Copies the cells of the world into the segment.
+  // World dimensions must match the ones given in the constructor.
+  void Publish(const World& world, uint64_t step);
+
+  bool Ok() const { return header_ != nullptr; }
+
+ private:
+  void Close() noexcept;
+
+  std::string name_;
+  SharedWorldHeader* header_{nullptr};
+  size_t size_{0};
+  uint32_t interval_{1};
+  uint32_t counter_{0};
+};
+
+// Read-only view of a segment created by a `WorldPublisher`.
+// Make sure to use `Ok()` to check if the segment could be opened.
+class WorldObserver {
+ public:
+  explicit WorldObserver(const std::string& name);
+  ~WorldObserver() noexcept;
+
+  // Disallow copies
+  WorldObserver(const WorldObserver&) = delete;
+  WorldObserver& operator=(const WorldObserver&) = delete;
+
+  // Copies the latest consistent frame into `cells_out` (resized if needed).
+  // Returns false if no consistent frame could be read (retry later).
+  bool Read(std::vector<World::CellType>* cells_out,
+            uint64_t* step_out = nullptr) const;
+
+  // Direct (zero-copy) access to the header and the cells.
+  // Contents may change while reading, validate with `header->sequence`.
+  const SharedWorldHeader* GetHeader() const { return header_; }
+  const World::CellType* GetCells() const;
+
+  bool Ok() const { return header_ != nullptr; }
+  int32_t GetWidth() const { return header_ ? header_->width : 0; }
+  int32_t GetHeight() const { return header_ ? header_->height : 0; }
+
+ private:
+  const SharedWorldHeader* header_{nullptr};
+  size_t size_{0};
+};
+
+#endif  // SDL2_SAND_SIMULATION_CORE_SRC_SHARED_WORLD_H_
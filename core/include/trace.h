@@ -0,0 +1,68 @@
+// MIT License
+
+#ifndef SDL2_SAND_SIMULATION_CORE_SRC_TRACE_H_
+#define SDL2_SAND_SIMULATION_CORE_SRC_TRACE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+
+// Opt-in timeline tracing.
+// Records timestamped begin / end events into per-thread ring buffers
+// (lock-free, no allocation while recording) and dumps them as a
+// Chrome trace-event JSON file (open with chrome://tracing or Perfetto).
+// Usage:
+// Call `Trace::Enable()` once at startup.
+// Put `TRACE_SCOPE("Name")` at the top of the blocks you want to see.
+// Call `Trace::Dump()` to write the file.
+// Event names must be string literals (only the pointer is stored).
+class Trace {
+ public:
+  // Events kept per thread by default (3 MiB, a few minutes of frames).
+  static constexpr size_t kDefaultEventsPerThread = 1 << 17;
+
+  // Starts recording. Every thread keeps its most recent `events_per_thread`
+  // events (older events are overwritten). Takes effect for the threads that
+  // did not record anything yet.
+  static void Enable(size_t events_per_thread = kDefaultEventsPerThread);
+  static bool IsEnabled();
+
+  static void Begin(const char* name);
+  static void End(const char* name);
+
+  // Writes the events kept so far. Safe to call while other threads
+  // are still recording. Scopes that are still open end at the time of the
+  // dump. Returns false if the file could not be written.
+  static bool Dump(const std::string& path);
+};
+
+// Records a begin event now and the matching end event at the end of the scope.
+class TraceScope {
+ public:
+  explicit TraceScope(const char* name) : name_(name) {
+    if (Trace::IsEnabled()) {
+      Trace::Begin(name_);
+    } else {
+      name_ = nullptr;
+    }
+  }
+  ~TraceScope() {
+    if (name_) {
+      Trace::End(name_);
+    }
+  }
+
+  // Disallow copies
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+
+ private:
+  const char* name_;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+
+#endif  // SDL2_SAND_SIMULATION_CORE_SRC_TRACE_H_
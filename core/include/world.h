@@ -3,31 +3,158 @@
 #ifndef SDL2_SAND_SIMULATION_CORE_SRC_WORLD_H_
 #define SDL2_SAND_SIMULATION_CORE_SRC_WORLD_H_
 
+#include <cstddef>
 #include <cstdint>
 
+#include <algorithm>
+#include <new>
+#include <span>
 #include <vector>
 
+// Allocator that places the first element on an `kAlignment` byte boundary.
+template <typename T, size_t kAlignment>
+struct AlignedAllocator {
+  using value_type = T;
+
+  template <typename U>
+  struct rebind {
+    using other = AlignedAllocator<U, kAlignment>;
+  };
+
+  AlignedAllocator() = default;
+  template <typename U>
+  AlignedAllocator(const AlignedAllocator<U, kAlignment>&) {}
+
+  T* allocate(size_t n) {
+    return static_cast<T*>(
+        ::operator new(n * sizeof(T), std::align_val_t(kAlignment)));
+  }
+  void deallocate(T* p, size_t) {
+    ::operator delete(p, std::align_val_t(kAlignment));
+  }
+
+  template <typename U>
+  bool operator==(const AlignedAllocator<U, kAlignment>&) const {
+    return true;
+  }
+};
+
 // Defines the main world.
 // Simulation is calculated in this class.
 // Set the simulation width and height in the constructor.
-// Use `GetCells()` to retrieve all the underlying cells.
+// Use `ForEachRun()` to retrieve the cells in runs of adjacent cells.
 // Call the `Update()` method to run the simulation.
+// The cells are surrounded by a one cell border of walls (never visible
+// through the coordinate API), so the update loop needs no bounds checks.
+// Two storage layouts are available (see `Layout`):
+// `kRows`: Rows are stored with a power-of-two stride, so index math is a
+// shift. Common widths use an update loop specialized at compile time.
+// Every row starts on a cache line.
+// `kTiles`: Cells are stored in 64x64 tiles (4 KiB, one line per tile row),
+// the cell below is usually 64 bytes away instead of a full row. `Update()`
+// runs tile by tile, so grains at vertical tile edges may settle differently
+// than with `kRows`.
+// `Update()` only examines the 64x64 regions where sand may still move.
+// The same regions count their sand, see `CountSand()`.
 class World {
  public:
-  enum class CellType : uint8_t { kEmpty = 0, kSand = 1 };
+  enum class CellType : uint8_t { kEmpty = 0, kSand = 1, kWall = 2 };
   
   // Static lookup table for colors.
   static constexpr uint32_t kColorTable[] = {
       0x00'00'00'FF,  // EMPTY
-      0xB8'9B'35'FF   // SAND
+      0xB8'9B'35'FF,  // SAND
+      0x80'80'80'FF   // WALL
   };
 
-  // Set the simulation width and height.
-  World(int32_t width, int32_t height);
+  // Alignment of every row in the underlying cells.
+  static constexpr size_t kRowAlignment = 64;
+
+  enum class Layout : uint8_t { kRows = 0, kTiles = 1 };
+
+  // Tiles are `kTileSize` x `kTileSize` cells, stored row-major.
+  static constexpr int32_t kTileShift = 6;
+  static constexpr int32_t kTileSize = 1 << kTileShift;
+
+  // Index of the padded coordinates (px, py) in the tiled layout.
+  // (the border is at px = 0 and py = 0)
+  static size_t TileIndex(int32_t px, int32_t py, int32_t tiles_x) {
+    const size_t tile = size_t(py >> kTileShift) * tiles_x + (px >> kTileShift);
+    return (tile << (2 * kTileShift)) +
+           ((py & (kTileSize - 1)) << kTileShift) + (px & (kTileSize - 1));
+  }
+
+  // Set the simulation width and height (and optionally the storage layout).
+  World(int32_t width, int32_t height, Layout layout = Layout::kRows);
 
   // Handles its own internal logic.
   // Pass the frame_count (required for randomness)
-  void Update(uint32_t frame_count);
+  // Returns the number of cells that moved (0 means the world is settled).
+  uint64_t Update(uint32_t frame_count);
+
+  // Limits of `RunToEquilibrium()`.
+  struct SettleLimits {
+    int32_t max_steps = 100'000;
+    // Wall clock budget, 0 means no limit.
+    double max_seconds = 0.0;
+  };
+
+  struct SettleResult {
+    // Steps run (including the final step that moved nothing).
+    int32_t steps = 0;
+    uint64_t moved_cells = 0;
+    // False if a limit was reached first.
+    bool settled = false;
+  };
+
+  // Calls `Update()` until a step moves nothing or a limit is reached.
+  // Frames are numbered from `first_frame`.
+  SettleResult RunToEquilibrium();
+  SettleResult RunToEquilibrium(const SettleLimits& limits,
+                                uint32_t first_frame = 0);
+
+  // Number of 64x64 regions the next `Update()` will examine.
+  int32_t GetActiveRegionCount() const;
+
+  // Population index: the number of sand cells of every 64x64 region
+  // (kept up to date by `SetCell()`, `WriteCells()` and `Update()`).
+  // Region (rx, ry) covers the world cells x in [64 * rx, 64 * rx + 64) and
+  // y in [64 * ry, 64 * ry + 64), the last regions of a row / column are
+  // clipped to the world (see `GetRegionBounds()`).
+  int32_t GetRegionCountX() const { return sand_regions_x_; }
+  int32_t GetRegionCountY() const { return sand_regions_y_; }
+
+  // Returns 0 for invalid regions.
+  uint32_t GetRegionSandCount(int32_t rx, int32_t ry) const;
+  bool IsRegionEmpty(int32_t rx, int32_t ry) const {
+    return GetRegionSandCount(rx, ry) == 0;
+  }
+
+  // World cells covered by the region.
+  struct Rect {
+    int32_t x = 0;
+    int32_t y = 0;
+    int32_t width = 0;
+    int32_t height = 0;
+  };
+  Rect GetRegionBounds(int32_t rx, int32_t ry) const;
+
+  // Calls `fn(rx, ry, sand_count)` for every region holding sand.
+  // Use it to skip the empty parts of the world.
+  template <typename Fn>
+  void ForEachOccupiedRegion(Fn&& fn) const;
+
+  // Number of sand cells in the rectangle (clipped to the world).
+  // Regions fully inside only read their counter, so a rectangle on region
+  // boundaries (multiples of 64 or the world edges) costs O(regions).
+  // Otherwise the non-empty regions cut by the edges of the rectangle are
+  // scanned: up to O(regions + 64 * perimeter) cells.
+  uint64_t CountSand(const Rect& rect) const;
+
+  // Fraction of sand in every region (0 to 1), row-major with
+  // `GetRegionCountX()` values per row. Suitable for a minimap.
+  // Reuses the memory of `map`.
+  void BuildDensityMap(std::vector<float>* map) const;
 
   // Internally checks if coordinates are valid
   // Updates only if the type provided differs from the cell type at that coords.
@@ -40,17 +167,120 @@ class World {
   int32_t GetWidth() const { return width_; };
   int32_t GetHeight() const { return height_; };
   uint64_t GetSandCount() const { return sand_count_; }
+  Layout GetLayout() const { return layout_; }
 
-  // You can use it to access the underlying cells (can be fed to a graphics API).
-  const std::vector<CellType>& GetCells() const { return cells_; };
+  // Calls `fn(x, y, cells)` for every run of horizontally adjacent cells
+  // starting at (x, y). Together the runs cover the world exactly once.
+  // (whole rows for `kRows`, tile rows for `kTiles`)
+  // Use it to feed the cells to a graphics API.
+  template <typename Fn>
+  void ForEachRun(Fn&& fn) const;
+
+  // Raw access to the underlying cells, including the border.
+  // The order of the cells depends on the layout.
+  std::span<const CellType> GetCells() const { return cells_; };
+
+  // Overwrites the underlying cells starting at `offset` (see `GetCells()`).
+  // Keeps the sand_count_ in sync. Out of range cells are ignored.
+  // The border and the padding are read-only (the update loop relies on
+  // them), their cells are skipped.
+  void WriteCells(size_t offset, std::span<const CellType> cells);
+
+  // Change tracking for incremental consumers (see `History`).
+  // Returns true if a cell in [offset, offset + count) of `GetCells()` may
+  // have changed since the last `ClearDirty()`. Changes are tracked per
+  // 64x64 region, so unchanged cells next to changed ones count as dirty.
+  bool IsDirty(size_t offset, size_t count) const;
+  void ClearDirty();
 
  private:
-  std::vector<CellType> cells_;
+  std::vector<CellType, AlignedAllocator<CellType, kRowAlignment>> cells_;
   uint64_t sand_count_{0};
   int32_t width_;
   int32_t height_;
+  Layout layout_;
+  // kRows: distance between two rows is `1 << stride_shift_`.
+  int32_t stride_shift_;
+  // kTiles: number of tiles in a row of tiles (border included).
+  int32_t tiles_x_;
+
+  // Activity flags of the 64x64 regions (same grid as the tiles).
+  std::vector<uint8_t> active_;
+  std::vector<uint8_t> next_active_;
+  int32_t regions_y_{0};
+  // Number of sand cells per region (world coordinates, unlike `active_`).
+  std::vector<uint32_t> region_sand_;
+  int32_t sand_regions_x_{0};
+  int32_t sand_regions_y_{0};
+  // Regions changed since the last `ClearDirty()`.
+  std::vector<uint8_t> dirty_;
+
+  // Internal state of a single `Update()` (see world.cc).
+  struct RegionActivity;
+
+  // Update loop selected in the constructor (specialized for the dimensions).
+  using UpdateFn = uint64_t (*)(CellType* origin, int32_t width,
+                                int32_t height, int32_t stride_shift,
+                                uint32_t frame_count,
+                                RegionActivity* activity);
+  UpdateFn update_fn_;
+  static UpdateFn SelectUpdate(int32_t width, int32_t stride_shift);
 
   bool IsValid(int32_t x, int32_t y) const;
+
+  // Makes the next `Update()` examine the regions around a changed cell.
+  void MarkActive(int32_t x, int32_t y);
+
+  // Region holding the cell at `offset` in `cells_` (border included).
+  size_t RegionOf(size_t offset) const;
+
+  // Coordinates of the cell at `offset` in `cells_`.
+  // Returns false for the border and the padding.
+  bool CellOf(size_t offset, int32_t* x, int32_t* y) const;
+
+  size_t SandRegion(int32_t x, int32_t y) const {
+    return size_t(y >> kTileShift) * sand_regions_x_ + (x >> kTileShift);
+  }
+
+  size_t Index(int32_t x, int32_t y) const {
+    if (layout_ == Layout::kTiles) {
+      return TileIndex(x + 1, y + 1, tiles_x_);
+    }
+    // Skips the top border row. (x = -1 is the last cell of the previous row)
+    return (size_t(y + 1) << stride_shift_) + x;
+  }
 };
 
+template <typename Fn>
+void World::ForEachRun(Fn&& fn) const {
+  for (int32_t y = 0; y < height_; ++y) {
+    if (layout_ == Layout::kRows) {
+      fn(0, y, std::span<const CellType>(cells_.data() + Index(0, y), width_));
+      continue;
+    }
+
+    // Split the row at the tile boundaries.
+    int32_t x = 0;
+    while (x < width_) {
+      const int32_t px = x + 1;
+      const int32_t length =
+          std::min(kTileSize - (px & (kTileSize - 1)), width_ - x);
+      fn(x, y, std::span<const CellType>(cells_.data() + Index(x, y), length));
+      x += length;
+    }
+  }
+}
+
+template <typename Fn>
+void World::ForEachOccupiedRegion(Fn&& fn) const {
+  for (int32_t ry = 0; ry < sand_regions_y_; ++ry) {
+    for (int32_t rx = 0; rx < sand_regions_x_; ++rx) {
+      const uint32_t count = region_sand_[size_t(ry) * sand_regions_x_ + rx];
+      if (count != 0) {
+        fn(rx, ry, count);
+      }
+    }
+  }
+}
+
 #endif  // SDL2_SAND_SIMULATION_CORE_SRC_WORLD_H_
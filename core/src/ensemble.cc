@@ -0,0 +1,132 @@
+// MIT License
+
+#include "ensemble.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+#include "trace.h"
+
+namespace {
+
+// Work queue of a single worker.
+// The owner takes from the back, thieves steal from the front.
+// Tasks are whole worlds (milliseconds of work), so a lock per queue is cheap.
+class WorkQueue {
+ public:
+  void Push(int32_t task) {
+    std::lock_guard lock(mutex_);
+    tasks_.push_back(task);
+  }
+
+  std::optional<int32_t> Pop() {
+    std::lock_guard lock(mutex_);
+    if (tasks_.empty())
+      return std::nullopt;
+    const int32_t task = tasks_.back();
+    tasks_.pop_back();
+    return task;
+  }
+
+  std::optional<int32_t> Steal() {
+    std::lock_guard lock(mutex_);
+    if (tasks_.empty())
+      return std::nullopt;
+    const int32_t task = tasks_.front();
+    tasks_.pop_front();
+    return task;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::deque<int32_t> tasks_;
+};
+
+}  // namespace
+
+Ensemble::Ensemble(const Config& config) : config_(config) {
+  thread_count_ = config.thread_count > 0
+                      ? config.thread_count
+                      : int32_t(std::thread::hardware_concurrency());
+  // Never start more threads than there are worlds.
+  thread_count_ = std::clamp(thread_count_, 1, std::max(config.world_count, 1));
+}
+
+Ensemble::Stats Ensemble::Run(const SetupFn& setup) const {
+  Stats stats;
+  stats.results.resize(std::max(config_.world_count, 0));
+
+  // Deal the worlds round-robin, stealing evens out the rest.
+  std::vector<std::unique_ptr<WorkQueue>> queues;
+  for (int32_t t = 0; t < thread_count_; ++t) {
+    queues.push_back(std::make_unique<WorkQueue>());
+  }
+  for (int32_t i = 0; i < config_.world_count; ++i) {
+    queues[i % thread_count_]->Push(i);
+  }
+
+  std::atomic<uint64_t> world_steps{0};
+
+  auto run_world = [&](int32_t index) {
+    TRACE_SCOPE("Ensemble::World");
+
+    World world(config_.width, config_.height, config_.layout);
+    if (setup) {
+      setup(&world, index);
+    }
+
+    World::SettleLimits limits;
+    limits.max_steps = config_.max_steps;
+    const World::SettleResult settle = world.RunToEquilibrium(limits);
+
+    Result& result = stats.results[index];
+    result.index = index;
+    result.steps = settle.steps;
+    result.settled = settle.settled;
+    result.moved_cells = settle.moved_cells;
+    result.sand_count = world.GetSandCount();
+    world_steps.fetch_add(result.steps, std::memory_order_relaxed);
+  };
+
+  auto worker = [&](int32_t id) {
+    TRACE_SCOPE("Ensemble::Worker");
+
+    while (true) {
+      std::optional<int32_t> task = queues[id]->Pop();
+
+      // Own queue is empty, try to steal from the others.
+      for (int32_t k = 1; !task && k < thread_count_; ++k) {
+        task = queues[(id + k) % thread_count_]->Steal();
+      }
+      // Nothing left anywhere (no new tasks are ever added).
+      if (!task)
+        return;
+
+      run_world(*task);
+    }
+  };
+
+  const auto start = std::chrono::steady_clock::now();
+
+  // The calling thread is worker 0.
+  std::vector<std::thread> threads;
+  for (int32_t t = 1; t < thread_count_; ++t) {
+    threads.emplace_back(worker, t);
+  }
+  worker(0);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  stats.seconds = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+  stats.world_steps = world_steps.load();
+  return stats;
+}
@@ -0,0 +1,167 @@
+// MIT License
+
+#include "history.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "trace.h"
+
+History::History(const Config& config) : config_(config) {
+  // A chunk must hold at least one cell.
+  config_.chunk_size = std::max<size_t>(config_.chunk_size, 1);
+}
+
+bool History::Save(World* world) {
+  TRACE_SCOPE("History::Save");
+  const auto cells = world->GetCells();
+  const size_t chunk_count =
+      (cells.size() + config_.chunk_size - 1) / config_.chunk_size;
+
+  // A world with different dimensions can not share chunks, start over.
+  if (!snapshots_.empty() && snapshots_[cursor_].size() != chunk_count) {
+    Clear();
+  }
+
+  const Snapshot* previous = snapshots_.empty() ? nullptr : &snapshots_[cursor_];
+
+  Snapshot snapshot;
+  snapshot.reserve(chunk_count);
+  size_t new_bytes = 0;
+
+  for (size_t c = 0; c < chunk_count; ++c) {
+    const size_t begin = c * config_.chunk_size;
+    const size_t size = std::min(config_.chunk_size, cells.size() - begin);
+
+    // Share the chunk if its contents did not change (only chunks with
+    // changed regions need the comparison).
+    if (previous && (!world->IsDirty(begin, size) ||
+                     std::memcmp((*previous)[c]->data(), cells.data() + begin,
+                                 size * sizeof(World::CellType)) == 0)) {
+      snapshot.push_back((*previous)[c]);
+      continue;
+    }
+
+    snapshot.push_back(std::make_shared<const std::vector<World::CellType>>(
+        cells.begin() + begin, cells.begin() + begin + size));
+    new_bytes += size * sizeof(World::CellType);
+  }
+  world->ClearDirty();
+
+  // Nothing changed since the last step.
+  if (previous && new_bytes == 0)
+    return false;
+
+  // Discard the redo steps.
+  while (!snapshots_.empty() && snapshots_.size() - 1 > cursor_) {
+    Release(snapshots_.back());
+    snapshots_.pop_back();
+    boundaries_.pop_back();
+  }
+
+  memory_usage_ += new_bytes + chunk_count * sizeof(Chunk);
+  snapshots_.push_back(std::move(snapshot));
+  boundaries_.push_back(false);
+  cursor_ = snapshots_.size() - 1;
+
+  // Drop the oldest steps until we fit (always keep the current one).
+  while (memory_usage_ > config_.memory_limit && snapshots_.size() > 1) {
+    Release(snapshots_.front());
+    snapshots_.pop_front();
+    boundaries_.pop_front();
+    cursor_--;
+  }
+  return true;
+}
+
+bool History::Undo(World* world) {
+  return Rewind(world, 1) == 1;
+}
+
+bool History::Redo(World* world) {
+  if (GetRedoCount() == 0)
+    return false;
+
+  cursor_++;
+  Restore(world, snapshots_[cursor_]);
+  return true;
+}
+
+int32_t History::Rewind(World* world, int32_t steps) {
+  const int32_t available = static_cast<int32_t>(GetUndoCount());
+  steps = std::clamp(steps, 0, available);
+  if (steps == 0)
+    return 0;
+
+  cursor_ -= steps;
+  Restore(world, snapshots_[cursor_]);
+  return steps;
+}
+
+void History::MarkBoundary() {
+  if (!snapshots_.empty()) {
+    boundaries_[cursor_] = true;
+  }
+}
+
+bool History::UndoToBoundary(World* world) {
+  if (GetUndoCount() == 0)
+    return false;
+
+  size_t target = cursor_ - 1;
+  while (target > 0 && !boundaries_[target]) {
+    target--;
+  }
+  return Rewind(world, int32_t(cursor_ - target)) > 0;
+}
+
+bool History::RedoToBoundary(World* world) {
+  if (GetRedoCount() == 0)
+    return false;
+
+  size_t target = cursor_ + 1;
+  while (target < snapshots_.size() - 1 && !boundaries_[target]) {
+    target++;
+  }
+  cursor_ = target;
+  Restore(world, snapshots_[cursor_]);
+  return true;
+}
+
+void History::Clear() {
+  snapshots_.clear();
+  boundaries_.clear();
+  cursor_ = 0;
+  memory_usage_ = 0;
+}
+
+size_t History::GetRedoCount() const {
+  return snapshots_.empty() ? 0 : snapshots_.size() - 1 - cursor_;
+}
+
+void History::Restore(World* world, const Snapshot& snapshot) const {
+  const auto cells = world->GetCells();
+
+  for (size_t c = 0; c < snapshot.size(); ++c) {
+    const size_t begin = c * config_.chunk_size;
+    const auto& chunk = *snapshot[c];
+
+    // Skip the chunks that already match.
+    if (begin + chunk.size() <= cells.size() &&
+        std::memcmp(chunk.data(), cells.data() + begin,
+                    chunk.size() * sizeof(World::CellType)) == 0)
+      continue;
+
+    world->WriteCells(begin, chunk);
+  }
+}
+
+void History::Release(const Snapshot& snapshot) {
+  for (const auto& chunk : snapshot) {
+    // Only this snapshot holds the chunk, it will be freed.
+    if (chunk.use_count() == 1) {
+      memory_usage_ -= chunk->size() * sizeof(World::CellType);
+    }
+  }
+  memory_usage_ -= snapshot.size() * sizeof(Chunk);
+}
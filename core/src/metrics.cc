@@ -0,0 +1,180 @@
+// MIT License
+
+#include "metrics.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fmt/format.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SAND_HAS_UNIX_SOCKETS 1
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr char kSocketPrefix[] = "unix:";
+
+// Nearest-rank percentile of the sorted range [first, last).
+float Percentile(float* first, float* last, double p) {
+  const size_t count = size_t(last - first);
+  if (count == 0)
+    return 0.0f;
+  size_t rank = size_t(p * count + 0.999999);
+  rank = std::clamp<size_t>(rank, 1, count);
+  // Partial sort only, the range is reused for the next percentile.
+  std::nth_element(first, first + rank - 1, last);
+  return first[rank - 1];
+}
+
+}  // namespace
+
+MetricsEmitter::MetricsEmitter(const Config& config)
+    : interval_(config.interval_seconds),
+      interval_start_(std::chrono::steady_clock::now()) {
+  const std::string& path = config.path;
+
+  if (path.rfind(kSocketPrefix, 0) == 0) {
+#ifdef SAND_HAS_UNIX_SOCKETS
+    const std::string socket_path = path.substr(sizeof(kSocketPrefix) - 1);
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+      fmt::println(stderr, "Metrics socket path is too long: {}", socket_path);
+      return;
+    }
+    std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size());
+
+    socket_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (socket_ < 0 || connect(socket_, reinterpret_cast<sockaddr*>(&address),
+                               sizeof(address)) != 0) {
+      fmt::println(stderr, "Error connecting metrics socket {}: {}",
+                   socket_path, std::strerror(errno));
+      if (socket_ >= 0) {
+        close(socket_);
+      }
+      socket_ = -1;
+      return;
+    }
+
+    // Never block the frame loop on a slow reader.
+    fcntl(socket_, F_SETFL, fcntl(socket_, F_GETFL) | O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+    const int on = 1;
+    setsockopt(socket_, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+#else
+    fmt::println(stderr, "Metrics sockets are not supported on this platform");
+#endif
+    return;
+  }
+
+  file_ = std::fopen(path.c_str(), "a");
+  if (!file_) {
+    fmt::println(stderr, "Error opening metrics file {}: {}", path,
+                 std::strerror(errno));
+  }
+}
+
+MetricsEmitter::~MetricsEmitter() noexcept {
+  Flush();
+  if (file_) {
+    std::fclose(file_);
+  }
+#ifdef SAND_HAS_UNIX_SOCKETS
+  if (socket_ >= 0) {
+    close(socket_);
+  }
+#endif
+}
+
+void MetricsEmitter::Record(const Sample& sample) {
+  if (!Ok())
+    return;
+
+  // Keep the most recent frame times if the interval has too many frames.
+  frame_ms_[frames_ % kMaxSamples] = float(sample.frame_ms);
+  frames_++;
+  frame_ms_max_ = std::max(frame_ms_max_, sample.frame_ms);
+  step_ms_sum_ += sample.step_ms;
+  step_ms_max_ = std::max(step_ms_max_, sample.step_ms);
+  if (sample.idle_ms > 0.0) {
+    idle_ms_sum_ += sample.idle_ms;
+    idle_frames_++;
+  }
+  upload_bytes_ += sample.upload_bytes;
+  last_ = sample;
+
+  if (std::chrono::steady_clock::now() - interval_start_ >= interval_) {
+    Flush();
+  }
+}
+
+void MetricsEmitter::Flush() {
+  interval_start_ = std::chrono::steady_clock::now();
+  if (!Ok() || frames_ == 0)
+    return;
+
+  float* first = frame_ms_.data();
+  float* last = first + std::min<uint64_t>(frames_, kMaxSamples);
+  const float p50 = Percentile(first, last, 0.50);
+  const float p90 = Percentile(first, last, 0.90);
+  const float p99 = Percentile(first, last, 0.99);
+
+  const auto timestamp = std::chrono::duration<double>(
+      std::chrono::system_clock::now().time_since_epoch());
+
+  // Format into the fixed buffer (truncated rather than allocating).
+  const auto result = fmt::format_to_n(
+      line_.data(), line_.size() - 1,
+      "{{\"time\":{:.3f},\"frames\":{},"
+      "\"frame_ms\":{{\"p50\":{:.3f},\"p90\":{:.3f},\"p99\":{:.3f},"
+      "\"max\":{:.3f}}},"
+      "\"step_ms\":{{\"mean\":{:.3f},\"max\":{:.3f}}},"
+      "\"idle\":{{\"frames\":{},\"ms\":{:.3f}}},"
+      "\"sand_count\":{},\"active_regions\":{},\"upload_bytes\":{}}}\n",
+      timestamp.count(), frames_, p50, p90, p99, frame_ms_max_,
+      step_ms_sum_ / frames_, step_ms_max_, idle_frames_, idle_ms_sum_,
+      last_.sand_count,
+      last_.active_regions, upload_bytes_);
+  Write(line_.data(), std::min(result.size, line_.size() - 1));
+
+  // Start a new interval.
+  frames_ = 0;
+  frame_ms_max_ = 0.0;
+  step_ms_sum_ = 0.0;
+  step_ms_max_ = 0.0;
+  idle_ms_sum_ = 0.0;
+  idle_frames_ = 0;
+  upload_bytes_ = 0;
+}
+
+void MetricsEmitter::Write(const char* data, size_t size) {
+  if (file_) {
+    std::fwrite(data, 1, size, file_);
+    std::fflush(file_);
+    return;
+  }
+#ifdef SAND_HAS_UNIX_SOCKETS
+#ifdef MSG_NOSIGNAL
+  const int flags = MSG_NOSIGNAL;
+#else
+  const int flags = 0;
+#endif
+  // A full socket buffer drops the record (the reader is too slow).
+  const ssize_t sent = send(socket_, data, size, flags);
+
+  // Half a line would corrupt the stream, give up on this reader.
+  if (sent > 0 && size_t(sent) < size) {
+    fmt::println(stderr, "Metrics socket can not keep up, closing it");
+    close(socket_);
+    socket_ = -1;
+  }
+#endif
+}
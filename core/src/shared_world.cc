@@ -0,0 +1,226 @@
+// MIT License
+
+#include "shared_world.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <utility>
+
+#include <fmt/core.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SAND_HAS_SHARED_MEMORY 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Cells start on their own cache line, right after the header.
+constexpr size_t kCellsOffset = 64;
+static_assert(sizeof(SharedWorldHeader) <= kCellsOffset);
+
+// POSIX segment names must start with a slash.
+std::string SegmentName(const std::string& name) {
+  return (!name.empty() && name[0] == '/') ? name : "/" + name;
+}
+
+}  // namespace
+
+WorldPublisher::WorldPublisher(const Config& config, int32_t width,
+                               int32_t height)
+    : name_(SegmentName(config.name)),
+      interval_(std::max<uint32_t>(config.interval, 1)) {
+#ifdef SAND_HAS_SHARED_MEMORY
+  size_ = kCellsOffset + static_cast<size_t>(width) * height;
+
+  // Never reuse a segment left behind by an earlier run: resizing it would
+  // crash the observers still mapping it (SIGBUS), and its header is already
+  // valid while it is rewritten. Those observers keep the orphaned segment,
+  // new ones only ever see the fresh (zeroed) one.
+  shm_unlink(name_.c_str());
+  int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0) {
+    fmt::println(stderr, "Error creating shared memory {}: {}", name_,
+                 std::strerror(errno));
+    return;
+  }
+
+  void* memory = MAP_FAILED;
+  if (ftruncate(fd, static_cast<off_t>(size_)) == 0) {
+    memory = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  close(fd);  // The mapping keeps the segment alive.
+
+  if (memory == MAP_FAILED) {
+    fmt::println(stderr, "Error mapping shared memory {}: {}", name_,
+                 std::strerror(errno));
+    shm_unlink(name_.c_str());
+    return;
+  }
+
+  header_ = new (memory) SharedWorldHeader{};
+  header_->width = width;
+  header_->height = height;
+  header_->sequence.store(0, std::memory_order_relaxed);
+  header_->step.store(0, std::memory_order_relaxed);
+  header_->version = SharedWorldHeader::kVersion;
+
+  // Observers check the magic first, publish it after everything else.
+  header_->magic.store(SharedWorldHeader::kMagic, std::memory_order_release);
+#else
+  fmt::println(stderr, "Shared memory is not supported on this platform");
+#endif
+}
+
+WorldPublisher::~WorldPublisher() noexcept {
+  Close();
+}
+
+// Move constructor
+WorldPublisher::WorldPublisher(WorldPublisher&& other) noexcept
+    : name_(std::move(other.name_)),
+      header_(std::exchange(other.header_, nullptr)),
+      size_(other.size_),
+      interval_(other.interval_),
+      counter_(other.counter_) {}
+
+// Move assignment
+WorldPublisher& WorldPublisher::operator=(WorldPublisher&& other) noexcept {
+  if (this != &other) {
+    // Free current segment before taking the new one
+    Close();
+    name_ = std::move(other.name_);
+    header_ = std::exchange(other.header_, nullptr);
+    size_ = other.size_;
+    interval_ = other.interval_;
+    counter_ = other.counter_;
+  }
+  return *this;
+}
+
+void WorldPublisher::Publish(const World& world, uint64_t step) {
+  if (!header_)
+    return;
+
+  // Skip frames, observers only need a sample of them.
+  if (counter_++ % interval_ != 0)
+    return;
+
+  const int32_t width = world.GetWidth();
+  const int32_t height = world.GetHeight();
+  if (width != header_->width || height != header_->height)
+    return;  // Dimension mismatch.
+
+  uint8_t* dest = reinterpret_cast<uint8_t*>(header_) + kCellsOffset;
+
+  // Seqlock write: odd sequence while the frame is incomplete.
+  const uint64_t sequence = header_->sequence.load(std::memory_order_relaxed);
+  header_->sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  // The world storage is padded, the segment rows are tightly packed.
+  world.ForEachRun([&](int32_t x, int32_t y, auto run) {
+    std::memcpy(dest + static_cast<size_t>(y) * width + x, run.data(),
+                run.size());
+  });
+  header_->step.store(step, std::memory_order_relaxed);
+
+  header_->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void WorldPublisher::Close() noexcept {
+#ifdef SAND_HAS_SHARED_MEMORY
+  if (header_) {
+    munmap(header_, size_);
+    shm_unlink(name_.c_str());
+    header_ = nullptr;
+  }
+#endif
+}
+
+WorldObserver::WorldObserver(const std::string& name) {
+#ifdef SAND_HAS_SHARED_MEMORY
+  const std::string segment = SegmentName(name);
+
+  int fd = shm_open(segment.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    fmt::println(stderr, "Error opening shared memory {}: {}", segment,
+                 std::strerror(errno));
+    return;
+  }
+
+  struct stat info;
+  void* memory = MAP_FAILED;
+  if (fstat(fd, &info) == 0 &&
+      static_cast<size_t>(info.st_size) >= kCellsOffset) {
+    size_ = static_cast<size_t>(info.st_size);
+    memory = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+
+  if (memory == MAP_FAILED) {
+    fmt::println(stderr, "Error mapping shared memory {}", segment);
+    return;
+  }
+
+  // The rest of the header is only valid once the magic is published.
+  const auto* header = static_cast<const SharedWorldHeader*>(memory);
+  const bool published = header->magic.load(std::memory_order_acquire) ==
+                         SharedWorldHeader::kMagic;
+  if (!published || header->version != SharedWorldHeader::kVersion ||
+      kCellsOffset + static_cast<size_t>(header->width) * header->height >
+          size_) {
+    fmt::println(stderr, "Shared memory {} is not a world segment", segment);
+    munmap(memory, size_);
+    return;
+  }
+  header_ = header;
+#endif
+}
+
+WorldObserver::~WorldObserver() noexcept {
+#ifdef SAND_HAS_SHARED_MEMORY
+  if (header_) {
+    munmap(const_cast<SharedWorldHeader*>(header_), size_);
+  }
+#endif
+}
+
+bool WorldObserver::Read(std::vector<World::CellType>* cells_out,
+                         uint64_t* step_out) const {
+  if (!header_)
+    return false;
+
+  const size_t count = static_cast<size_t>(header_->width) * header_->height;
+  cells_out->resize(count);
+
+  // Seqlock read: retry a few times if the publisher was writing.
+  for (int32_t attempt = 0; attempt < 16; ++attempt) {
+    const uint64_t before = header_->sequence.load(std::memory_order_acquire);
+    if (before & 1)
+      continue;
+
+    std::memcpy(cells_out->data(), GetCells(), count);
+    const uint64_t step = header_->step.load(std::memory_order_relaxed);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (header_->sequence.load(std::memory_order_relaxed) == before) {
+      if (step_out)
+        *step_out = step;
+      return true;
+    }
+  }
+  return false;
+}
+
+const World::CellType* WorldObserver::GetCells() const {
+  if (!header_)
+    return nullptr;
+  return reinterpret_cast<const World::CellType*>(
+      reinterpret_cast<const uint8_t*>(header_) + kCellsOffset);
+}
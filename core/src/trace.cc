@@ -0,0 +1,183 @@
+// MIT License
+
+#include "trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <fmt/core.h>
+
+namespace {
+
+// Fields are atomic because `Trace::Dump()` may read a slot while its
+// thread overwrites it (the torn copy is discarded).
+struct Event {
+  std::atomic<const char*> name{nullptr};
+  std::atomic<uint64_t> timestamp_ns{0};
+  std::atomic<char> phase{0};  // 'B'egin or 'E'nd
+};
+
+// Ring of the most recent events of a thread.
+// Written only by its own thread, read by `Trace::Dump()`.
+// Event number `i` is stored at `events[i % capacity]`, `head` is the number
+// of events recorded so far.
+struct ThreadBuffer {
+  explicit ThreadBuffer(uint32_t id, size_t capacity)
+      : thread_id(id),
+        capacity(capacity),
+        events(std::make_unique<Event[]>(capacity)) {}
+
+  uint32_t thread_id;
+  size_t capacity;
+  std::unique_ptr<Event[]> events;
+  std::atomic<uint64_t> head{0};
+};
+
+std::atomic<bool> enabled{false};
+size_t capacity{0};
+const auto start_time = std::chrono::steady_clock::now();
+
+// Buffers outlive their threads, so events of finished workers are kept.
+std::mutex buffers_mutex;
+std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+uint64_t Now() {
+  const auto now = std::chrono::steady_clock::now() - start_time;
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+}
+
+ThreadBuffer* GetThreadBuffer() {
+  thread_local ThreadBuffer* buffer = nullptr;
+  if (!buffer) {
+    // Only the first event of a thread takes the lock.
+    std::lock_guard lock(buffers_mutex);
+    buffers.push_back(std::make_unique<ThreadBuffer>(
+        static_cast<uint32_t>(buffers.size() + 1), capacity));
+    buffer = buffers.back().get();
+  }
+  return buffer;
+}
+
+void Record(const char* name, char phase) {
+  ThreadBuffer* buffer = GetThreadBuffer();
+  if (buffer->capacity == 0)
+    return;
+
+  // Overwrites the oldest event once the ring is full.
+  const uint64_t head = buffer->head.load(std::memory_order_relaxed);
+  Event& event = buffer->events[head % buffer->capacity];
+
+  // `Dump()` must see the head of this event before any of its fields
+  // (the reader checks the head after copying).
+  std::atomic_thread_fence(std::memory_order_release);
+  event.name.store(name, std::memory_order_relaxed);
+  event.timestamp_ns.store(Now(), std::memory_order_relaxed);
+  event.phase.store(phase, std::memory_order_relaxed);
+
+  // Publish the event to `Dump()`.
+  buffer->head.store(head + 1, std::memory_order_release);
+}
+
+}  // namespace
+
+void Trace::Enable(size_t events_per_thread) {
+  {
+    std::lock_guard lock(buffers_mutex);
+    capacity = events_per_thread;
+  }
+  enabled.store(true, std::memory_order_release);
+}
+
+bool Trace::IsEnabled() {
+  return enabled.load(std::memory_order_relaxed);
+}
+
+void Trace::Begin(const char* name) {
+  Record(name, 'B');
+}
+
+void Trace::End(const char* name) {
+  Record(name, 'E');
+}
+
+bool Trace::Dump(const std::string& path) {
+  struct Copy {
+    const char* name;
+    uint64_t timestamp_ns;
+    char phase;
+  };
+
+  std::FILE* file = std::fopen(path.c_str(), "w");
+  if (!file) {
+    fmt::println(stderr, "Error opening trace file: {}", path);
+    return false;
+  }
+
+  fmt::print(file, "{{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+  bool first = true;
+  auto print = [&](const char* name, char phase, uint64_t timestamp_ns,
+                   uint32_t thread_id) {
+    // Chrome expects microseconds.
+    fmt::print(file,
+               "{}\n{{\"name\":\"{}\",\"ph\":\"{}\",\"ts\":{:.3f},"
+               "\"pid\":1,\"tid\":{}}}",
+               first ? "" : ",", name, phase, timestamp_ns / 1000.0,
+               thread_id);
+    first = false;
+  };
+
+  std::vector<Copy> events;
+  std::vector<const char*> open_scopes;
+
+  std::lock_guard lock(buffers_mutex);
+  for (const auto& buffer : buffers) {
+    // Copy the ring while its thread keeps recording.
+    const uint64_t head = buffer->head.load(std::memory_order_acquire);
+    const uint64_t begin =
+        head > buffer->capacity ? head - buffer->capacity : 0;
+    events.clear();
+    for (uint64_t i = begin; i < head; ++i) {
+      const Event& event = buffer->events[i % buffer->capacity];
+      events.push_back({event.name.load(std::memory_order_relaxed),
+                        event.timestamp_ns.load(std::memory_order_relaxed),
+                        event.phase.load(std::memory_order_relaxed)});
+    }
+
+    // Drop the events that were overwritten during the copy.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64_t new_head = buffer->head.load(std::memory_order_relaxed);
+    const uint64_t valid =
+        new_head >= buffer->capacity ? new_head - buffer->capacity + 1 : 0;
+    const size_t skip = size_t(std::min(std::max(valid, begin), head) - begin);
+
+    // Scopes nest per thread: skip the ends whose begin was overwritten,
+    // and end the scopes that are still open at the time of the dump.
+    open_scopes.clear();
+    for (size_t i = skip; i < events.size(); ++i) {
+      const Copy& event = events[i];
+      if (event.phase == 'B') {
+        open_scopes.push_back(event.name);
+      } else if (!open_scopes.empty()) {
+        open_scopes.pop_back();
+      } else {
+        continue;
+      }
+      print(event.name, event.phase, event.timestamp_ns, buffer->thread_id);
+    }
+    const uint64_t now = Now();
+    while (!open_scopes.empty()) {
+      print(open_scopes.back(), 'E', now, buffer->thread_id);
+      open_scopes.pop_back();
+    }
+  }
+
+  fmt::print(file, "\n]}}\n");
+  return std::fclose(file) == 0;
+}
@@ -2,44 +2,167 @@
 
 #include "world.h"
 
-World::World(int32_t width, int32_t height) : width_(width), height_(height) {
-  cells_.resize(width * height, CellType::kEmpty);
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <iterator>
+#include <utility>
+
+#include "trace.h"
+
+// Which 64x64 regions may contain moving sand.
+// Regions use the padded coordinates (same grid as the tiles of `kTiles`).
+// A grain that was blocked stays blocked until a cell next to it is vacated,
+// so skipping the other regions gives exactly the same result as a full step.
+struct World::RegionActivity {
+  // Regions to examine in this step (grows while the step runs).
+  uint8_t* current;
+  // Regions to examine in the next step.
+  uint8_t* next;
+  // Regions whose cells changed.
+  uint8_t* dirty;
+  int32_t regions_x;
+  // Sand count of every region in world coordinates (see `World::CountSand`).
+  uint32_t* sand;
+  int32_t sand_regions_x;
+
+  size_t Region(int32_t x, int32_t y) const {
+    return size_t((y + 1) >> kTileShift) * regions_x +
+           ((x + 1) >> kTileShift);
+  }
+
+  size_t SandRegion(int32_t x, int32_t y) const {
+    return size_t(y >> kTileShift) * sand_regions_x + (x >> kTileShift);
+  }
+
+  // Whether a grain moving from (x, y) to (to_x, y + 1) enters another
+  // region of the sand counts. `row_crossing` is `RowCrossing(y)`.
+  static bool Crosses(int32_t x, int32_t to_x, int32_t row_crossing) {
+    return ((x ^ to_x) | row_crossing) >= kTileSize;
+  }
+  // `kTileSize` if the row below `y` is in the next row of regions.
+  static int32_t RowCrossing(int32_t y) {
+    return ((y + 1) & (kTileSize - 1)) == 0 ? kTileSize : 0;
+  }
+
+  // A grain moved from (x, y) to (to_x, y + 1) into another region of the
+  // sand counts (see `Crosses()`).
+  void OnMove(int32_t x, int32_t y, int32_t to_x) {
+    sand[SandRegion(x, y)]--;
+    sand[SandRegion(to_x, y + 1)]++;
+  }
+
+  // Grains moved from row `y` of region column `rx` (once per row and region,
+  // not per grain). `left` / `right` tell whether a grain on the first / last
+  // cell of the row moved, its neighbours are in the next region.
+  void OnRowMoved(int32_t rx, int32_t y, bool left, bool right) {
+    const size_t row = size_t((y + 1) >> kTileShift) * regions_x;
+    const size_t below = size_t((y + 2) >> kTileShift) * regions_x;
+    const size_t above = size_t(y >> kTileShift) * regions_x;
+
+    const int32_t first = left && rx > 0 ? rx - 1 : rx;
+    const int32_t last = right && rx + 1 < regions_x ? rx + 1 : rx;
+    for (int32_t r = first; r <= last; ++r) {
+      // The grains may keep moving in the next step.
+      next[below + r] = 1;
+      dirty[below + r] = 1;
+      // The grains above may fall into the vacated cells (rows above are
+      // examined later in this step).
+      current[above + r] = 1;
+    }
+    dirty[row + rx] = 1;
+  }
+
+  // A grain on the edge next to region column `rx` left row `y` after `rx`
+  // was processed (tiled traversal only). The grains of `rx` above may fall
+  // into the vacated cell in the next step.
+  void OnEdgeVacated(int32_t rx, int32_t y) {
+    if (rx >= 0 && rx < regions_x)
+      next[size_t(y >> kTileShift) * regions_x + rx] = 1;
+  }
+};
+
+namespace {
+
+using CellType = World::CellType;
+
+// Marks a dimension that is only known at runtime.
+constexpr int32_t kDynamic = -1;
+
+// Rows are at least a cache line apart (keeps every row aligned).
+constexpr int32_t kMinStrideShift = std::countr_zero(World::kRowAlignment);
+
+// Smallest power-of-two stride that fits a row and its right border.
+// (The left border is the last cell of the previous row)
+constexpr int32_t StrideShift(int32_t width) {
+  return std::max(kMinStrideShift,
+                  int32_t(std::bit_width(uint32_t(std::max(width, 0)))));
 }
 
-void World::Update(uint32_t frame_count) {
-  // Iterate bottom to top
-  // Iterate left to right
-  for (int32_t y = height_ - 1; y >= 0; --y) {
+// The simulation step.
+// `kWidth` and `kStrideShift` are compile-time constants when they are not
+// `kDynamic`, which turns the loop bounds and the index math into constants.
+// `origin` points to the cell (0, 0), the border walls surround it so
+// neighbours never need a bounds check.
+// Every row is split at the region boundaries, inactive regions are skipped.
+// (`Activity` is always `World::RegionActivity`, which is private.)
+template <int32_t kWidth, int32_t kStrideShift, typename Activity>
+uint64_t UpdateRows(CellType* origin, int32_t width, int32_t height,
+                    int32_t stride_shift, uint32_t frame_count,
+                    Activity* activity) {
+  constexpr int32_t kRegionShift = World::kTileShift;
+
+  const int32_t w = kWidth == kDynamic ? width : kWidth;
+  const int32_t shift = kStrideShift == kDynamic ? stride_shift : kStrideShift;
 
-    // Alternating x direction
-    bool flow_right = (frame_count & 1) == 0;
+  // Alternating x direction
+  const bool flow_right = (frame_count & 1) == 0;
+  const int32_t step_x = flow_right ? 1 : -1;
 
-    int32_t start_x = flow_right ? 0 : width_ - 1;
-    int32_t end_x = flow_right ? width_ : -1;  // Loop ends when x equals this
-    int32_t step_x = flow_right ? 1 : -1;
+  // Region columns holding the padded x range [1, width].
+  const int32_t last_region = w >> kRegionShift;
 
-    for (int32_t x = start_x; x != end_x; x += step_x) {
+  uint64_t moved = 0;
 
-      // Calculate the index of the current cell
-      int32_t i = y * width_ + x;
+  // Iterate bottom to top
+  for (int32_t y = height - 1; y >= 0; --y) {
+
+    // The current row and the row below (the floor is a row of walls).
+    CellType* const row = origin + (ptrdiff_t(y) << shift);
+    CellType* const below = row + (ptrdiff_t(1) << shift);
+
+    const uint8_t* const active =
+        activity->current + activity->Region(-1, y);
+    const int32_t row_crossing = Activity::RowCrossing(y);
 
-      // If (current) cell empty, skip it.
-      if (cells_[i] == CellType::kEmpty)
+    for (int32_t r = 0; r <= last_region; ++r) {
+      const int32_t rx = flow_right ? r : last_region - r;
+      if (!active[rx])
         continue;
 
-      if (cells_[i] == CellType::kSand) {
+      // Part of the row inside the region (world x coordinates).
+      const int32_t begin_x = std::max((rx << kRegionShift) - 1, 0);
+      const int32_t end_x = std::min(((rx + 1) << kRegionShift) - 1, w);
 
-        // If it is floor, skip it.
-        if ((y + 1) >= height_)
-          continue;
+      const int32_t start = flow_right ? begin_x : end_x - 1;
+      const int32_t end = flow_right ? end_x : begin_x - 1;
+
+      // Cells of this row are only vacated in this pass, so the grains on
+      // the edges moved if their cells are empty afterwards.
+      const bool left_sand = row[begin_x] == CellType::kSand;
+      const bool right_sand = row[end_x - 1] == CellType::kSand;
+      uint64_t region_moved = 0;
 
-        // Calculate the index of the cell below
-        int32_t below_i = (y + 1) * width_ + x;
+      for (int32_t x = start; x != end; x += step_x) {
 
+        // Only sand moves, skip everything else.
+        if (row[x] != CellType::kSand)
+          continue;
+
+        int32_t to_x = x;
         // Rule 1: Fall straight down if empty
-        if (cells_[below_i] == CellType::kEmpty) {
-          cells_[below_i] = CellType::kSand;
-          cells_[i] = CellType::kEmpty;
+        if (below[x] == CellType::kEmpty) {
+          to_x = x;
         }
         // Rule 2: Slide down-left or down-right (Simple friction)
         else {
@@ -52,26 +175,471 @@ void World::Update(uint32_t frame_count) {
           int32_t first_dx = try_left_first ? -1 : 1;
           int32_t second_dx = try_left_first ? 1 : -1;
 
-          // Try primary direction.
-          int32_t below_primary = below_i + first_dx;
-          if (x + first_dx >= 0 && x + first_dx < width_ &&
-              cells_[below_primary] == CellType::kEmpty) {
-            cells_[below_primary] = CellType::kSand;
-            cells_[i] = CellType::kEmpty;
+          // Try primary direction (walls are never empty).
+          if (below[x + first_dx] == CellType::kEmpty) {
+            to_x = x + first_dx;
           }
           // Try secondary direction.
+          else if (below[x + second_dx] == CellType::kEmpty) {
+            to_x = x + second_dx;
+          }
+          // Blocked.
           else {
-            int32_t below_secondary = below_i + second_dx;
-            if (x + second_dx >= 0 && x + second_dx < width_ &&
-                cells_[below_secondary] == CellType::kEmpty) {
-              cells_[below_secondary] = CellType::kSand;
-              cells_[i] = CellType::kEmpty;
-            }
+            continue;
           }
         }  // End of rules
-      }  // End of CellType::kSand if
-    }  // End of inner for loop
+
+        below[to_x] = CellType::kSand;
+        row[x] = CellType::kEmpty;
+        region_moved++;
+        if (Activity::Crosses(x, to_x, row_crossing))
+          activity->OnMove(x, y, to_x);
+      }  // End of region
+
+      if (region_moved > 0) {
+        activity->OnRowMoved(rx, y,
+                             left_sand && row[begin_x] != CellType::kSand,
+                             right_sand && row[end_x - 1] != CellType::kSand);
+        moved += region_moved;
+      }
+    }  // End of row
   }  // End of outer for loop
+
+  return moved;
+}
+
+// The simulation step for the tiled layout.
+// Visits the rows of tiles bottom to top and every tile as a whole, its lines
+// bottom to top, so a step streams through one 4 KiB tile at a time.
+// Tiles are the regions of `RegionActivity`, inactive ones are skipped.
+// Unlike `UpdateRows()`, a tile runs before its neighbour in the flow
+// direction has processed the same lines. A grain sliding into that neighbour
+// is handed off: its cell is filled only once the neighbour processed the line
+// below (it can't move twice). Grains at a vertical tile edge may therefore
+// block or slide differently than with `kRows`, the rules stay the same.
+template <typename Activity>
+uint64_t UpdateTiles(CellType* cells, int32_t width, int32_t height,
+                     int32_t tiles_x, uint32_t frame_count,
+                     Activity* activity) {
+  constexpr int32_t kShift = World::kTileShift;
+  constexpr int32_t kSize = World::kTileSize;
+  constexpr int32_t kMask = kSize - 1;
+
+  // Alternating x direction
+  const bool flow_right = (frame_count & 1) == 0;
+  const int32_t step_x = flow_right ? 1 : -1;
+  // Column of a tile entered by grains handed off from the previous one.
+  const int32_t entry_lx = flow_right ? 0 : kMask;
+
+  // Tile columns / rows holding the padded ranges [1, width] / [1, height].
+  const int32_t last_tile = width >> kShift;
+  const int32_t last_tile_y = height >> kShift;
+
+  uint64_t moved = 0;
+
+  // Iterate bottom to top
+  for (int32_t ty = last_tile_y; ty >= 0; --ty) {
+    const int32_t begin_py = std::max(ty << kShift, 1);
+    const int32_t end_py = std::min((ty + 1) << kShift, height + 1);
+    const uint8_t* const active = activity->current + size_t(ty) * tiles_x;
+
+    // Lines of the next tile receiving a grain from the current one (bit l
+    // for line l, lines below the last one of the tile are written directly).
+    uint64_t hand_off = 0;
+
+    for (int32_t t = 0; t <= last_tile; ++t) {
+      const int32_t tx = flow_right ? t : last_tile - t;
+      const uint64_t arrivals = hand_off;
+      hand_off = 0;
+
+      CellType* const tile =
+          cells + World::TileIndex(tx << kShift, ty << kShift, tiles_x);
+
+      // Nothing moves in this tile, the grains can land right away.
+      if (!active[tx]) {
+        for (int32_t l = 1; l < kSize; ++l) {
+          if ((arrivals >> l) & 1)
+            tile[(l << kShift) + entry_lx] = CellType::kSand;
+        }
+        continue;
+      }
+
+      // Part of the tile inside the world (padded x coordinates).
+      const int32_t begin_px = std::max(tx << kShift, 1);
+      const int32_t end_px = std::min((tx + 1) << kShift, width + 1);
+
+      // The same range in tile coordinates (the loop runs on those).
+      const int32_t tile_px = tx << kShift;
+      const int32_t start_lx = (flow_right ? begin_px : end_px - 1) - tile_px;
+      const int32_t end_lx = (flow_right ? end_px : begin_px - 1) - tile_px;
+
+      for (int32_t py = end_py - 1; py >= begin_py; --py) {
+        const int32_t y = py - 1;
+        const int32_t l = py & kMask;
+        const int32_t row_crossing = Activity::RowCrossing(y);
+
+        // The current tile line and the one below (indexed with px & kMask).
+        CellType* const line = tile + (l << kShift);
+        CellType* const below =
+            l != kMask
+                ? line + kSize
+                : cells + World::TileIndex(tx << kShift, py + 1, tiles_x);
+
+        // The line below is processed, grains handed off into it land now.
+        if (l != kMask && ((arrivals >> (l + 1)) & 1))
+          below[entry_lx] = CellType::kSand;
+
+        // Cells of this line are only vacated in this pass, so the grains on
+        // the edges moved if their cells are empty afterwards.
+        const bool left_sand = line[begin_px & kMask] == CellType::kSand;
+        const bool right_sand = line[(end_px - 1) & kMask] == CellType::kSand;
+        uint64_t line_moved = 0;
+
+        for (int32_t lx = start_lx; lx != end_lx; lx += step_x) {
+          const int32_t px = tile_px + lx;
+
+          // Only sand moves, skip everything else.
+          if (line[lx] != CellType::kSand)
+            continue;
+
+          // Diagonal neighbours at the tile edge live in the next tile.
+          auto below_at = [&](int32_t dx) -> CellType& {
+            const int32_t neighbour = lx + dx;
+            if ((neighbour & ~kMask) == 0)
+              return below[neighbour];
+            return cells[World::TileIndex(px + dx, py + 1, tiles_x)];
+          };
+
+          int32_t dx = 0;
+          // Rule 1: Fall straight down if empty
+          if (below[lx] == CellType::kEmpty) {
+            dx = 0;
+          }
+          // Rule 2: Slide down-left or down-right (Simple friction)
+          // Same "free" randomness as `UpdateRows()` (world coordinates).
+          else {
+            bool try_left_first = ((px - 1) + y + frame_count) & 1;
+            int32_t first_dx = try_left_first ? -1 : 1;
+            int32_t second_dx = try_left_first ? 1 : -1;
+
+            // Try primary direction (walls are never empty).
+            if (below_at(first_dx) == CellType::kEmpty) {
+              dx = first_dx;
+            }
+            // Try secondary direction.
+            else if (below_at(second_dx) == CellType::kEmpty) {
+              dx = second_dx;
+            }
+            // Blocked.
+            else {
+              continue;
+            }
+          }  // End of rules
+
+          line[lx] = CellType::kEmpty;
+          if (((lx + dx) & ~kMask) == 0)
+            below[lx + dx] = CellType::kSand;
+          else if (dx == step_x && l != kMask)
+            hand_off |= uint64_t(1) << (l + 1);
+          else
+            below_at(dx) = CellType::kSand;
+          line_moved++;
+          if (Activity::Crosses(px - 1, px - 1 + dx, row_crossing))
+            activity->OnMove(px - 1, y, px - 1 + dx);
+        }  // End of tile line
+
+        if (line_moved > 0) {
+          const bool left =
+              left_sand && line[begin_px & kMask] != CellType::kSand;
+          const bool right =
+              right_sand && line[(end_px - 1) & kMask] != CellType::kSand;
+          activity->OnRowMoved(tx, y, left, right);
+          // The previous tile is done, its grains may fall into the vacated
+          // edge cell in the next step.
+          if (flow_right ? left : right)
+            activity->OnEdgeVacated(tx - step_x, y);
+          moved += line_moved;
+        }
+      }  // End of tile
+    }  // End of row of tiles
+  }  // End of outer for loop
+
+  return moved;
+}
+
+}  // namespace
+
+World::UpdateFn World::SelectUpdate(int32_t width, int32_t stride_shift) {
+  using Activity = RegionActivity;
+
+  // Precompiled common deployment widths (screen sizes and ensemble worlds).
+  static constexpr std::pair<int32_t, UpdateFn> kFixedWidths[] = {
+      {256, &UpdateRows<256, StrideShift(256), Activity>},
+      {512, &UpdateRows<512, StrideShift(512), Activity>},
+      {640, &UpdateRows<640, StrideShift(640), Activity>},
+      {1024, &UpdateRows<1024, StrideShift(1024), Activity>},
+      {1280, &UpdateRows<1280, StrideShift(1280), Activity>},
+      {1920, &UpdateRows<1920, StrideShift(1920), Activity>},
+      {2048, &UpdateRows<2048, StrideShift(2048), Activity>},
+      {2560, &UpdateRows<2560, StrideShift(2560), Activity>},
+  };
+
+  // Any other width still gets a constant stride (shift) if it is common.
+  static constexpr UpdateFn kFixedStrides[] = {
+      &UpdateRows<kDynamic, kMinStrideShift, Activity>,
+      &UpdateRows<kDynamic, 7, Activity>,
+      &UpdateRows<kDynamic, 8, Activity>,
+      &UpdateRows<kDynamic, 9, Activity>,
+      &UpdateRows<kDynamic, 10, Activity>,
+      &UpdateRows<kDynamic, 11, Activity>,
+      &UpdateRows<kDynamic, 12, Activity>,
+  };
+
+  for (const auto& [fixed_width, fn] : kFixedWidths) {
+    if (fixed_width == width)
+      return fn;
+  }
+  const size_t index = size_t(stride_shift - kMinStrideShift);
+  if (index < std::size(kFixedStrides))
+    return kFixedStrides[index];
+
+  return &UpdateRows<kDynamic, kDynamic, Activity>;
+}
+
+World::World(int32_t width, int32_t height, Layout layout)
+    : width_(width),
+      height_(height),
+      layout_(layout),
+      stride_shift_(StrideShift(width)),
+      // Enough tiles for the world and its border.
+      tiles_x_((width + 2 + kTileSize - 1) >> kTileShift),
+      update_fn_(SelectUpdate(width, stride_shift_)) {
+  // Everything is a wall (border rows and columns, padding)...
+  if (layout_ == Layout::kTiles) {
+    const int32_t tiles_y = (height + 2 + kTileSize - 1) >> kTileShift;
+    cells_.resize(size_t(tiles_x_) * tiles_y << (2 * kTileShift),
+                  CellType::kWall);
+  } else {
+    cells_.resize(size_t(height + 2) << stride_shift_, CellType::kWall);
+  }
+
+  // ...except the cells inside the world.
+  ForEachRun([this](int32_t x, int32_t y, std::span<const CellType> run) {
+    std::fill_n(cells_.begin() + Index(x, y), run.size(), CellType::kEmpty);
+  });
+
+  // Regions use the same grid as the tiles (border included).
+  regions_y_ = (height + 2 + kTileSize - 1) >> kTileShift;
+  active_.resize(size_t(tiles_x_) * regions_y_, 0);
+  next_active_.resize(active_.size(), 0);
+  sand_regions_x_ = (width + kTileSize - 1) >> kTileShift;
+  sand_regions_y_ = (height + kTileSize - 1) >> kTileShift;
+  region_sand_.resize(size_t(sand_regions_x_) * sand_regions_y_, 0);
+  // Nothing has been seen by a consumer yet.
+  dirty_.resize(active_.size(), 1);
+}
+
+uint64_t World::Update(uint32_t frame_count) {
+  TRACE_SCOPE("World::Update");
+
+  // The regions marked during the last step (and by `SetCell()`) are examined.
+  std::swap(active_, next_active_);
+  std::fill(next_active_.begin(), next_active_.end(), 0);
+
+  RegionActivity activity{active_.data(),       next_active_.data(),
+                          dirty_.data(),        tiles_x_,
+                          region_sand_.data(), sand_regions_x_};
+  if (layout_ == Layout::kTiles) {
+    return UpdateTiles(cells_.data(), width_, height_, tiles_x_, frame_count,
+                       &activity);
+  }
+  return update_fn_(cells_.data() + Index(0, 0), width_, height_, stride_shift_,
+                    frame_count, &activity);
+}
+
+World::SettleResult World::RunToEquilibrium() {
+  return RunToEquilibrium(SettleLimits{});
+}
+
+World::SettleResult World::RunToEquilibrium(const SettleLimits& limits,
+                                            uint32_t first_frame) {
+  TRACE_SCOPE("World::RunToEquilibrium");
+
+  const auto start = std::chrono::steady_clock::now();
+  const auto budget = std::chrono::duration<double>(limits.max_seconds);
+
+  SettleResult result;
+  while (result.steps < limits.max_steps) {
+    const uint64_t moved = Update(first_frame + uint32_t(result.steps));
+    result.steps++;
+
+    // Stop as soon as a step moves nothing.
+    if (moved == 0) {
+      result.settled = true;
+      break;
+    }
+    result.moved_cells += moved;
+
+    if (limits.max_seconds > 0.0 &&
+        std::chrono::steady_clock::now() - start >= budget)
+      break;
+  }
+  return result;
+}
+
+int32_t World::GetActiveRegionCount() const {
+  return int32_t(std::count(next_active_.begin(), next_active_.end(), 1));
+}
+
+void World::MarkActive(int32_t x, int32_t y) {
+  // The cell itself and the grains above that may fall into it.
+  for (int32_t dx = -1; dx <= 1; dx += 2) {
+    for (int32_t dy = -1; dy <= 0; ++dy) {
+      const int32_t px = std::clamp(x + dx, -1, width_) + 1;
+      const int32_t py = std::clamp(y + dy, -1, height_) + 1;
+      next_active_[size_t(py >> kTileShift) * tiles_x_ + (px >> kTileShift)] =
+          1;
+    }
+  }
+}
+
+size_t World::RegionOf(size_t offset) const {
+  // Tiles are the regions.
+  if (layout_ == Layout::kTiles)
+    return offset >> (2 * kTileShift);
+
+  // The row is the padded y, the column is the x coordinate (the padding
+  // after the right border belongs to the border).
+  const size_t py = offset >> stride_shift_;
+  const size_t column = offset & ((size_t(1) << stride_shift_) - 1);
+  const size_t px = std::min(column + 1, size_t(width_) + 1);
+  return (py >> kTileShift) * tiles_x_ + (px >> kTileShift);
+}
+
+bool World::IsDirty(size_t offset, size_t count) const {
+  const size_t end = std::min(offset + count, cells_.size());
+  if (offset >= end)
+    return false;
+
+  // Tiles are the regions.
+  if (layout_ == Layout::kTiles) {
+    const auto first = dirty_.begin() + (offset >> (2 * kTileShift));
+    const auto last = dirty_.begin() + ((end - 1) >> (2 * kTileShift)) + 1;
+    return std::find(first, last, 1) != last;
+  }
+
+  // The regions of a row are adjacent, check the part of every row.
+  for (size_t py = offset >> stride_shift_; py <= (end - 1) >> stride_shift_;
+       ++py) {
+    const size_t begin = std::max(offset, py << stride_shift_);
+    const size_t row_end = std::min(end, (py + 1) << stride_shift_);
+    const auto first = dirty_.begin() + RegionOf(begin);
+    const auto last = dirty_.begin() + RegionOf(row_end - 1) + 1;
+    if (std::find(first, last, 1) != last)
+      return true;
+  }
+  return false;
+}
+
+void World::ClearDirty() {
+  std::fill(dirty_.begin(), dirty_.end(), 0);
+}
+
+bool World::CellOf(size_t offset, int32_t* x, int32_t* y) const {
+  size_t px;
+  size_t py;
+  if (layout_ == Layout::kTiles) {
+    constexpr size_t kMask = kTileSize - 1;
+    const size_t tile = offset >> (2 * kTileShift);
+    px = ((tile % tiles_x_) << kTileShift) + (offset & kMask);
+    py = ((tile / tiles_x_) << kTileShift) + ((offset >> kTileShift) & kMask);
+  } else {
+    // Padding after the right border maps past the world (px > width).
+    px = (offset & ((size_t(1) << stride_shift_) - 1)) + 1;
+    py = offset >> stride_shift_;
+  }
+  if (px < 1 || px > size_t(width_) || py < 1 || py > size_t(height_))
+    return false;
+
+  *x = int32_t(px) - 1;
+  *y = int32_t(py) - 1;
+  return true;
+}
+
+uint32_t World::GetRegionSandCount(int32_t rx, int32_t ry) const {
+  if (rx < 0 || ry < 0 || rx >= sand_regions_x_ || ry >= sand_regions_y_)
+    return 0;
+  return region_sand_[size_t(ry) * sand_regions_x_ + rx];
+}
+
+World::Rect World::GetRegionBounds(int32_t rx, int32_t ry) const {
+  if (rx < 0 || ry < 0 || rx >= sand_regions_x_ || ry >= sand_regions_y_)
+    return {};
+
+  const int32_t x = rx << kTileShift;
+  const int32_t y = ry << kTileShift;
+  return {x, y, std::min(kTileSize, width_ - x),
+          std::min(kTileSize, height_ - y)};
+}
+
+uint64_t World::CountSand(const Rect& rect) const {
+  const int32_t x0 = std::max(rect.x, 0);
+  const int32_t y0 = std::max(rect.y, 0);
+  const int32_t x1 = std::min(rect.x + rect.width, width_);
+  const int32_t y1 = std::min(rect.y + rect.height, height_);
+  if (x0 >= x1 || y0 >= y1)
+    return 0;
+
+  uint64_t count = 0;
+  for (int32_t ry = y0 >> kTileShift; ry <= (y1 - 1) >> kTileShift; ++ry) {
+    for (int32_t rx = x0 >> kTileShift; rx <= (x1 - 1) >> kTileShift; ++rx) {
+      const uint32_t region_count =
+          region_sand_[size_t(ry) * sand_regions_x_ + rx];
+      if (region_count == 0)
+        continue;
+
+      const Rect bounds = GetRegionBounds(rx, ry);
+      const int32_t bx0 = std::max(bounds.x, x0);
+      const int32_t by0 = std::max(bounds.y, y0);
+      const int32_t bx1 = std::min(bounds.x + bounds.width, x1);
+      const int32_t by1 = std::min(bounds.y + bounds.height, y1);
+
+      // Fully covered, the counter is the answer.
+      if (bx0 == bounds.x && by0 == bounds.y &&
+          bx1 == bounds.x + bounds.width && by1 == bounds.y + bounds.height) {
+        count += region_count;
+        continue;
+      }
+
+      // On the edge of the rectangle, count the covered part.
+      // (split at the tiles of `kTiles`, they are shifted by the border)
+      for (int32_t y = by0; y < by1; ++y) {
+        int32_t x = bx0;
+        while (x < bx1) {
+          const int32_t length =
+              layout_ == Layout::kTiles
+                  ? std::min(kTileSize - ((x + 1) & (kTileSize - 1)), bx1 - x)
+                  : bx1 - x;
+          const CellType* const run = cells_.data() + Index(x, y);
+          count += uint64_t(std::count(run, run + length, CellType::kSand));
+          x += length;
+        }
+      }
+    }
+  }
+  return count;
+}
+
+void World::BuildDensityMap(std::vector<float>* map) const {
+  map->resize(region_sand_.size());
+  for (int32_t ry = 0; ry < sand_regions_y_; ++ry) {
+    for (int32_t rx = 0; rx < sand_regions_x_; ++rx) {
+      const size_t region = size_t(ry) * sand_regions_x_ + rx;
+      const Rect bounds = GetRegionBounds(rx, ry);
+      const int32_t area = bounds.width * bounds.height;
+      (*map)[region] = float(region_sand_[region]) / area;
+    }
+  }
 }
 
 // Internally checks if coordinates are valid
@@ -79,21 +647,59 @@ void World::Update(uint32_t frame_count) {
 // (Reqired to safely update the sand_count_)
 void World::SetCell(int32_t x, int32_t y, CellType type) {
   if (IsValid(x, y)) {
-    if (type != cells_[width_ * y + x]) {
+    CellType& cell = cells_[Index(x, y)];
+    if (type != cell) {
 
-      if (type == CellType::kSand)
-        sand_count_++;
-      else
+      uint32_t& region_sand = region_sand_[SandRegion(x, y)];
+      if (cell == CellType::kSand) {
         sand_count_--;
+        region_sand--;
+      }
+      if (type == CellType::kSand) {
+        sand_count_++;
+        region_sand++;
+      }
 
-      cells_[width_ * y + x] = type;
+      cell = type;
+      dirty_[RegionOf(Index(x, y))] = 1;
+      MarkActive(x, y);
     }
   }
 }
 
+void World::WriteCells(size_t offset, std::span<const CellType> cells) {
+  if (offset >= cells_.size())
+    return;
+
+  const size_t count = std::min(cells.size(), cells_.size() - offset);
+  for (size_t i = 0; i < count; ++i) {
+    CellType& cell = cells_[offset + i];
+    int32_t x;
+    int32_t y;
+    if (cell == cells[i] || !CellOf(offset + i, &x, &y))
+      continue;
+
+    if (cell == CellType::kSand) {
+      sand_count_--;
+      region_sand_[SandRegion(x, y)]--;
+    }
+    if (cells[i] == CellType::kSand) {
+      sand_count_++;
+      region_sand_[SandRegion(x, y)]++;
+    }
+    dirty_[RegionOf(offset + i)] = 1;
+
+    cell = cells[i];
+  }
+
+  // The mapping of `offset` to coordinates depends on the layout,
+  // simply examine everything in the next step.
+  std::fill(next_active_.begin(), next_active_.end(), 1);
+}
+
 World::CellType World::GetCell(int32_t x, int32_t y) const {
   if (IsValid(x, y)) {
-    return cells_[width_ * y + x];
+    return cells_[Index(x, y)];
   }
   // Return empty cell if invalid
   return CellType::kEmpty;
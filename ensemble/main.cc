@@ -0,0 +1,125 @@
+// MIT License
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+#include <fmt/core.h>
+
+#include "ensemble.h"
+#include "world.h"
+
+namespace {
+
+// Builds an hourglass out of walls and fills the upper bulb with sand.
+// The seed decides which cells of the bulb get a grain.
+void MakeHourglass(World* world, uint32_t seed) {
+  const int32_t width = world->GetWidth();
+  const int32_t height = world->GetHeight();
+  const int32_t center = width / 2;
+  const int32_t neck = std::max(width / 64, 1);
+
+  std::mt19937 random(seed);
+  std::bernoulli_distribution fill(0.6);
+
+  for (int32_t y = 0; y < height; ++y) {
+    // Half width of the glass: narrows towards the middle row, then widens.
+    const int32_t distance = std::abs(y - height / 2);
+    const int32_t half = neck + distance * (center - neck) / (height / 2);
+
+    for (int32_t x = 0; x < width; ++x) {
+      if (std::abs(x - center) >= half) {
+        world->SetCell(x, y, World::CellType::kWall);
+      } else if (y < height / 2 && fill(random)) {
+        world->SetCell(x, y, World::CellType::kSand);
+      }
+    }
+  }
+}
+
+void PrintUsage(const char* program) {
+  fmt::println(stderr,
+               "Usage: {} [--worlds <n >= 1>] [--size <n >= 4>] "
+               "[--steps <n >= 1>] [--threads <n >= 0>] [--tiles]",
+               program);
+}
+
+// Parses a whole decimal argument, returns false for anything else.
+bool ParseInt(const char* text, int32_t* value) {
+  char* end = nullptr;
+  const long parsed = std::strtol(text, &end, 10);
+  if (end == text || *end != '\0' || parsed < INT32_MIN || parsed > INT32_MAX)
+    return false;
+  *value = int32_t(parsed);
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  // Default configuration values
+  Ensemble::Config config;
+
+  // --worlds <n> --size <n> --steps <n> --threads <n> --tiles
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--tiles") {
+      config.layout = World::Layout::kTiles;
+      continue;
+    }
+
+    int32_t value = 0;
+    if (i + 1 >= argc || !ParseInt(argv[++i], &value)) {
+      PrintUsage(argv[0]);
+      return 1;
+    }
+    if (arg == "--worlds") {
+      config.world_count = value;
+    } else if (arg == "--size") {
+      config.width = value;
+      config.height = value;
+    } else if (arg == "--steps") {
+      config.max_steps = value;
+    } else if (arg == "--threads") {
+      config.thread_count = value;
+    } else {
+      PrintUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  // The hourglass needs a few rows above and below its neck.
+  if (config.world_count < 1 || config.width < 4 || config.max_steps < 1 ||
+      config.thread_count < 0) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  Ensemble ensemble(config);
+  fmt::println("Running {} hourglasses of {}x{} on {} threads...",
+               config.world_count, config.width, config.height,
+               ensemble.GetThreadCount());
+
+  const Ensemble::Stats stats = ensemble.Run(
+      [](World* world, int32_t index) { MakeHourglass(world, index); });
+
+  int32_t settled = 0;
+  uint64_t total_steps = 0;
+  for (const auto& result : stats.results) {
+    if (result.settled) {
+      settled++;
+      total_steps += result.steps;
+    }
+  }
+
+  fmt::println("Settled: {} / {}", settled, stats.results.size());
+  if (settled > 0) {
+    fmt::println("Average steps to settle: {:.1f}",
+                 double(total_steps) / settled);
+  }
+  fmt::println("Time: {:.3f} s, throughput: {:.0f} world-steps/s",
+               stats.seconds, stats.GetStepsPerSecond());
+  return 0;
+}
\ No newline at end of file
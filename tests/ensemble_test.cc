@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+
+#include "ensemble.h"
+#include "world.h"
+
+TEST(Ensemble, SettlesEveryWorld) {
+  Ensemble::Config config;
+  config.world_count = 16;
+  config.width = 32;
+  config.height = 32;
+  config.thread_count = 4;
+  Ensemble ensemble(config);
+
+  // World `i` starts with `i` grains in the top row.
+  const Ensemble::Stats stats = ensemble.Run([](World* world, int32_t index) {
+    for (int32_t x = 0; x < index; ++x) {
+      world->SetCell(x, 0, World::CellType::kSand);
+    }
+  });
+
+  ASSERT_EQ(stats.results.size(), 16);
+  for (int32_t i = 0; i < 16; ++i) {
+    const auto& result = stats.results[i];
+    EXPECT_EQ(result.index, i);
+    EXPECT_TRUE(result.settled);
+    EXPECT_EQ(result.sand_count, uint64_t(i));
+  }
+  // An empty world settles in a single step, a filled one needs the fall.
+  EXPECT_EQ(stats.results[0].steps, 1);
+  EXPECT_GT(stats.results[15].steps, 31);
+  EXPECT_GT(stats.world_steps, 0);
+}
+
+TEST(Ensemble, StopsAtMaxSteps) {
+  Ensemble::Config config;
+  config.world_count = 2;
+  config.width = 16;
+  config.height = 64;
+  config.max_steps = 8;
+  Ensemble ensemble(config);
+
+  const Ensemble::Stats stats = ensemble.Run([](World* world, int32_t) {
+    world->SetCell(0, 0, World::CellType::kSand);
+  });
+  for (const auto& result : stats.results) {
+    EXPECT_FALSE(result.settled);
+    EXPECT_EQ(result.steps, 8);
+  }
+}
@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "history.h"
+#include "world.h"
+
+// Small chunks so a single cell change touches a single chunk
+static History::Config SmallChunks() {
+  History::Config config;
+  config.chunk_size = 16;
+  return config;
+}
+
+TEST(History, UndoRedoRestoresCells) {
+  World world(8, 8);
+  History history(SmallChunks());
+  history.Save(&world);
+
+  world.SetCell(3, 3, World::CellType::kSand);
+  history.Save(&world);
+
+  EXPECT_TRUE(history.Undo(&world));
+  EXPECT_EQ(world.GetCell(3, 3), World::CellType::kEmpty);
+  EXPECT_EQ(world.GetSandCount(), 0);
+
+  EXPECT_TRUE(history.Redo(&world));
+  EXPECT_EQ(world.GetCell(3, 3), World::CellType::kSand);
+  EXPECT_EQ(world.GetSandCount(), 1);
+
+  EXPECT_FALSE(history.Redo(&world));
+}
+
+TEST(History, SkipsUnchangedSteps) {
+  World world(8, 8);
+  History history(SmallChunks());
+  EXPECT_TRUE(history.Save(&world));
+  EXPECT_FALSE(history.Save(&world));
+  EXPECT_EQ(history.GetUndoCount(), 0);
+}
+
+TEST(History, RewindMovesBackSeveralSteps) {
+  World world(8, 8);
+  History history(SmallChunks());
+  history.Save(&world);
+  for (int32_t x = 0; x < 4; ++x) {
+    world.SetCell(x, 0, World::CellType::kSand);
+    history.Save(&world);
+  }
+
+  EXPECT_EQ(history.Rewind(&world, 3), 3);
+  EXPECT_EQ(world.GetSandCount(), 1);
+  EXPECT_EQ(history.Rewind(&world, 10), 1);
+  EXPECT_EQ(world.GetSandCount(), 0);
+  EXPECT_EQ(history.GetRedoCount(), 4);
+}
+
+TEST(History, SharesUnchangedChunks) {
+  World world(64, 64);
+  History::Config config;
+  config.chunk_size = 256;
+  History history(config);
+  history.Save(&world);
+  const size_t full = history.GetMemoryUsage();
+
+  world.SetCell(0, 0, World::CellType::kSand);
+  history.Save(&world);
+
+  // The second step only stores a single new chunk
+  const size_t delta = history.GetMemoryUsage() - full;
+  EXPECT_LT(delta, full / 4);
+}
+
+TEST(History, DropsOldestStepsOverMemoryLimit) {
+  World world(64, 64);
+  History::Config config = SmallChunks();
+  config.memory_limit = 32 * 1024;
+  History history(config);
+
+  for (int32_t i = 0; i < 32; ++i) {
+    world.SetCell(i, i, World::CellType::kSand);
+    history.Save(&world);
+  }
+  EXPECT_LE(history.GetMemoryUsage(), config.memory_limit);
+  EXPECT_LT(history.GetUndoCount(), 31);
+}
+
+TEST(History, UndoesSimulationStepsOfEveryLayout) {
+  for (auto layout : {World::Layout::kRows, World::Layout::kTiles}) {
+    World world(200, 150, layout);
+    History history;
+    for (int32_t x = 0; x < 200; x += 3) {
+      world.SetCell(x, x % 50, World::CellType::kSand);
+    }
+    history.Save(&world);
+
+    // Only the regions the kernels touched are compared, the steps must
+    // still be restored exactly.
+    std::vector<std::vector<World::CellType>> states;
+    for (uint32_t frame = 0; frame < 40; ++frame) {
+      states.emplace_back(world.GetCells().begin(), world.GetCells().end());
+      world.Update(frame);
+      ASSERT_TRUE(history.Save(&world));
+    }
+
+    for (auto state = states.rbegin(); state != states.rend(); ++state) {
+      ASSERT_TRUE(history.Undo(&world));
+      ASSERT_TRUE(std::equal(state->begin(), state->end(),
+                             world.GetCells().begin()));
+    }
+  }
+}
+
+TEST(History, UndoesWholeStrokesBetweenBoundaries) {
+  World world(8, 8);
+  History history(SmallChunks());
+  history.Save(&world);
+
+  // Two strokes of several steps each.
+  for (int32_t stroke = 0; stroke < 2; ++stroke) {
+    history.MarkBoundary();
+    for (int32_t x = 0; x < 3; ++x) {
+      world.SetCell(x, stroke, World::CellType::kSand);
+      history.Save(&world);
+    }
+    history.MarkBoundary();
+  }
+  EXPECT_EQ(world.GetSandCount(), 6);
+
+  EXPECT_TRUE(history.UndoToBoundary(&world));
+  EXPECT_EQ(world.GetSandCount(), 3);
+  EXPECT_TRUE(history.UndoToBoundary(&world));
+  EXPECT_EQ(world.GetSandCount(), 0);
+  EXPECT_FALSE(history.UndoToBoundary(&world));
+
+  EXPECT_TRUE(history.RedoToBoundary(&world));
+  EXPECT_EQ(world.GetSandCount(), 3);
+
+  // Saving an unchanged world keeps the redo steps.
+  EXPECT_FALSE(history.Save(&world));
+  EXPECT_TRUE(history.RedoToBoundary(&world));
+  EXPECT_EQ(world.GetSandCount(), 6);
+  EXPECT_FALSE(history.RedoToBoundary(&world));
+}
@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "metrics.h"
+
+static std::string ReadFile(const std::string& path) {
+  std::ifstream file(path);
+  return std::string(std::istreambuf_iterator<char>(file), {});
+}
+
+TEST(Metrics, AggregatesAnIntervalIntoOneLine) {
+  const std::string path = ::testing::TempDir() + "metrics_test.jsonl";
+  std::remove(path.c_str());
+  {
+    // Long interval, only the explicit flush emits.
+    MetricsEmitter metrics({.path = path, .interval_seconds = 3600.0});
+    ASSERT_TRUE(metrics.Ok());
+
+    for (int32_t i = 1; i <= 100; ++i) {
+      metrics.Record({.frame_ms = double(i),
+                      .step_ms = 2.0,
+                      .idle_ms = i % 4 == 0 ? 250.0 : 0.0,
+                      .sand_count = uint64_t(i),
+                      .active_regions = 7,
+                      .upload_bytes = 10});
+    }
+    metrics.Flush();
+    // Nothing recorded since, nothing more is written.
+    metrics.Flush();
+  }
+
+  const std::string contents = ReadFile(path);
+  EXPECT_EQ(std::count(contents.begin(), contents.end(), '\n'), 1);
+  EXPECT_NE(contents.find("\"frames\":100,"), std::string::npos);
+  EXPECT_NE(contents.find("\"p50\":50.000,\"p90\":90.000,\"p99\":99.000,"
+                          "\"max\":100.000"),
+            std::string::npos);
+  EXPECT_NE(contents.find("\"step_ms\":{\"mean\":2.000,\"max\":2.000}"),
+            std::string::npos);
+  // Sleeping is reported on its own, the percentiles above exclude it.
+  EXPECT_NE(contents.find("\"idle\":{\"frames\":25,\"ms\":6250.000}"),
+            std::string::npos);
+  EXPECT_NE(contents.find("\"sand_count\":100,\"active_regions\":7,"
+                          "\"upload_bytes\":1000}"),
+            std::string::npos);
+  std::remove(path.c_str());
+}
+
+TEST(Metrics, ZeroIntervalEmitsEveryFrame) {
+  const std::string path = ::testing::TempDir() + "metrics_every_frame.jsonl";
+  std::remove(path.c_str());
+  {
+    MetricsEmitter metrics({.path = path, .interval_seconds = 0.0});
+    for (int32_t i = 0; i < 3; ++i) {
+      metrics.Record({.frame_ms = 16.0});
+    }
+  }
+  const std::string contents = ReadFile(path);
+  EXPECT_EQ(std::count(contents.begin(), contents.end(), '\n'), 3);
+  std::remove(path.c_str());
+}
@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "shared_world.h"
+#include "world.h"
+
+TEST(SharedWorld, ObserverReadsPublishedFrame) {
+#if !defined(__unix__) && !defined(__APPLE__)
+  GTEST_SKIP() << "POSIX shared memory is not available";
+#endif
+  const std::string name = "/sand_world_test";
+
+  World world(16, 8);
+  world.SetCell(4, 2, World::CellType::kSand);
+
+  WorldPublisher publisher({.name = name}, world.GetWidth(),
+                           world.GetHeight());
+  ASSERT_TRUE(publisher.Ok());
+  publisher.Publish(world, 42);
+
+  WorldObserver observer(name);
+  ASSERT_TRUE(observer.Ok());
+  EXPECT_EQ(observer.GetWidth(), 16);
+  EXPECT_EQ(observer.GetHeight(), 8);
+
+  std::vector<World::CellType> cells;
+  uint64_t step = 0;
+  ASSERT_TRUE(observer.Read(&cells, &step));
+  EXPECT_EQ(step, 42);
+  EXPECT_EQ(cells[2 * 16 + 4], World::CellType::kSand);
+  EXPECT_EQ(cells[0], World::CellType::kEmpty);
+}
+
+TEST(SharedWorld, NewPublisherDoesNotResizeAMappedSegment) {
+#if !defined(__unix__) && !defined(__APPLE__)
+  GTEST_SKIP() << "POSIX shared memory is not available";
+#endif
+  const std::string name = "/sand_world_test_restart";
+
+  // A large world left behind by an earlier run, still observed.
+  World large(64, 64);
+  large.SetCell(63, 63, World::CellType::kSand);
+  WorldPublisher old_publisher({.name = name}, 64, 64);
+  ASSERT_TRUE(old_publisher.Ok());
+  old_publisher.Publish(large, 1);
+  WorldObserver old_observer(name);
+  ASSERT_TRUE(old_observer.Ok());
+
+  // A restart with a smaller world gets a fresh segment.
+  WorldPublisher publisher({.name = name}, 8, 8);
+  ASSERT_TRUE(publisher.Ok());
+  WorldObserver observer(name);
+  ASSERT_TRUE(observer.Ok());
+  EXPECT_EQ(observer.GetWidth(), 8);
+
+  // The old mapping is intact (no SIGBUS when touching its last cell).
+  std::vector<World::CellType> cells;
+  ASSERT_TRUE(old_observer.Read(&cells));
+  EXPECT_EQ(cells.back(), World::CellType::kSand);
+}
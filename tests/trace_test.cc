@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "trace.h"
+
+static std::string ReadFile(const std::string& path) {
+  std::ifstream file(path);
+  std::stringstream contents;
+  contents << file.rdbuf();
+  return contents.str();
+}
+
+static size_t CountOf(const std::string& text, const std::string& pattern) {
+  size_t count = 0;
+  for (size_t pos = text.find(pattern); pos != std::string::npos;
+       pos = text.find(pattern, pos + 1)) {
+    count++;
+  }
+  return count;
+}
+
+TEST(Trace, DumpsEventsOfEveryThread) {
+  Trace::Enable();
+  {
+    TRACE_SCOPE("MainScope");
+    std::thread worker([] { TRACE_SCOPE("WorkerScope"); });
+    worker.join();
+  }
+
+  const std::string path = ::testing::TempDir() + "trace_test.json";
+  ASSERT_TRUE(Trace::Dump(path));
+
+  const std::string json = ReadFile(path);
+
+  EXPECT_EQ(json.rfind("{\"displayTimeUnit\"", 0), 0);
+  EXPECT_NE(json.find("\"name\":\"MainScope\",\"ph\":\"B\""), std::string::npos);
+  EXPECT_NE(json.find("\"name\":\"MainScope\",\"ph\":\"E\""), std::string::npos);
+  EXPECT_NE(json.find("\"name\":\"WorkerScope\""), std::string::npos);
+  std::remove(path.c_str());
+}
+
+TEST(Trace, RingKeepsTheNewestCompleteScopes) {
+  // Only threads that did not record yet get the new capacity.
+  Trace::Enable(8);
+  const std::string path = ::testing::TempDir() + "trace_ring_test.json";
+
+  std::string open_json;
+  std::string wrapped_json;
+  std::thread worker([&] {
+    TRACE_SCOPE("RingOpen");
+    for (int32_t i = 0; i < 3; ++i) {
+      TRACE_SCOPE("RingScope");
+    }
+    ASSERT_TRUE(Trace::Dump(path));
+    open_json = ReadFile(path);
+
+    for (int32_t i = 0; i < 100; ++i) {
+      TRACE_SCOPE("RingScope");
+    }
+    ASSERT_TRUE(Trace::Dump(path));
+    wrapped_json = ReadFile(path);
+  });
+  worker.join();
+  Trace::Enable();
+
+  // The open scope is ended at the time of the dump.
+  EXPECT_EQ(CountOf(open_json, "\"name\":\"RingOpen\",\"ph\":\"B\""), 1);
+  EXPECT_EQ(CountOf(open_json, "\"name\":\"RingOpen\",\"ph\":\"E\""), 1);
+  EXPECT_EQ(CountOf(open_json, "\"name\":\"RingScope\""), 6);
+
+  // Only the newest events are kept, the begin of "RingOpen" is gone.
+  // (The oldest slot of a full ring may be in use, it is never dumped:
+  // 7 events are left, the first one is an end without its begin.)
+  EXPECT_EQ(CountOf(wrapped_json, "\"name\":\"RingOpen\""), 0);
+  EXPECT_EQ(CountOf(wrapped_json, "\"name\":\"RingScope\",\"ph\":\"B\""),
+            3);
+  EXPECT_EQ(CountOf(wrapped_json, "\"name\":\"RingScope\",\"ph\":\"E\""),
+            3);
+  std::remove(path.c_str());
+}
@@ -0,0 +1,432 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "world.h"
+
+// Runs the same scenario on a precompiled width, a width with a precompiled
+// stride and a width that only has the fully dynamic update loop.
+class WorldWidths : public ::testing::TestWithParam<int32_t> {};
+
+TEST_P(WorldWidths, SandFallsToTheFloor) {
+  const int32_t width = GetParam();
+  World world(width, 16);
+  world.SetCell(width / 2, 0, World::CellType::kSand);
+
+  for (uint32_t frame = 0; frame < 32; ++frame) {
+    world.Update(frame);
+  }
+  EXPECT_EQ(world.GetCell(width / 2, 15), World::CellType::kSand);
+  EXPECT_EQ(world.GetCell(width / 2, 0), World::CellType::kEmpty);
+  EXPECT_EQ(world.GetSandCount(), 1);
+}
+
+TEST_P(WorldWidths, SandSlidesOffAPile) {
+  const int32_t width = GetParam();
+  World world(width, 4);
+  world.SetCell(0, 3, World::CellType::kSand);
+  world.SetCell(0, 2, World::CellType::kSand);
+
+  for (uint32_t frame = 0; frame < 8; ++frame) {
+    world.Update(frame);
+  }
+  // The top grain can only slide to the right (left is the edge).
+  EXPECT_EQ(world.GetCell(0, 3), World::CellType::kSand);
+  EXPECT_EQ(world.GetCell(1, 3), World::CellType::kSand);
+}
+
+TEST_P(WorldWidths, RunsCoverEveryCellOnce) {
+  const int32_t width = GetParam();
+  for (auto layout : {World::Layout::kRows, World::Layout::kTiles}) {
+    World world(width, 70, layout);
+    world.SetCell(width - 1, 69, World::CellType::kSand);
+
+    uint64_t cells = 0;
+    uint64_t sand = 0;
+    world.ForEachRun([&](int32_t x, int32_t y, auto run) {
+      for (size_t i = 0; i < run.size(); ++i) {
+        EXPECT_EQ(run[i], world.GetCell(x + int32_t(i), y));
+        sand += run[i] == World::CellType::kSand;
+      }
+      cells += run.size();
+    });
+    EXPECT_EQ(cells, uint64_t(width) * 70);
+    EXPECT_EQ(sand, 1);
+  }
+}
+
+TEST_P(WorldWidths, TiledLayoutMatchesRowsAwayFromTileEdges) {
+  const int32_t width = GetParam();
+  World rows(width, 130, World::Layout::kRows);
+  World tiles(width, 130, World::Layout::kTiles);
+
+  // Same pseudo random pile in both worlds, walled in between the vertical
+  // tile edges (tile x is world x + 1).
+  for (int32_t y = 0; y < 130; ++y) {
+    for (int32_t x = 0; x < width; ++x) {
+      const int32_t lx = (x + 1) % World::kTileSize;
+      auto type = World::CellType((x * 7 + y * 13) % 5 == 0 ? 1 : 0);
+      if (lx == 2 || lx == 61)
+        type = World::CellType::kWall;
+      else if (lx < 2 || lx > 61)
+        type = World::CellType::kEmpty;
+      rows.SetCell(x, y, type);
+      tiles.SetCell(x, y, type);
+    }
+  }
+
+  for (uint32_t frame = 0; frame < 40; ++frame) {
+    EXPECT_EQ(rows.Update(frame), tiles.Update(frame));
+  }
+  for (int32_t y = 0; y < 130; ++y) {
+    for (int32_t x = 0; x < width; ++x) {
+      ASSERT_EQ(rows.GetCell(x, y), tiles.GetCell(x, y)) << x << ", " << y;
+    }
+  }
+}
+
+TEST_P(WorldWidths, TiledLayoutKeepsEveryGrain) {
+  const int32_t width = GetParam();
+  World world(width, 150, World::Layout::kTiles);
+
+  // A dense pile, grains keep crossing the tile edges.
+  for (int32_t y = 0; y < 150; ++y) {
+    for (int32_t x = 0; x < width; ++x) {
+      if ((x * 7 + y * 13) % 3 != 0) {
+        world.SetCell(x, y, World::CellType::kSand);
+      }
+    }
+  }
+  const uint64_t sand = world.GetSandCount();
+
+  const World::SettleResult result = world.RunToEquilibrium();
+  EXPECT_TRUE(result.settled);
+
+  uint64_t counted = 0;
+  for (int32_t y = 0; y < 150; ++y) {
+    for (int32_t x = 0; x < width; ++x) {
+      counted += world.GetCell(x, y) == World::CellType::kSand;
+      // Settled: no grain rests above an empty cell.
+      if (y + 1 < 150 && world.GetCell(x, y) == World::CellType::kSand) {
+        ASSERT_NE(world.GetCell(x, y + 1), World::CellType::kEmpty)
+            << x << ", " << y;
+      }
+    }
+  }
+  EXPECT_EQ(counted, sand);
+}
+
+INSTANTIATE_TEST_SUITE_P(World, WorldWidths,
+                         ::testing::Values(256, 1920, 300, 5000));
+
+TEST(World, InvalidCoordinatesAreIgnored) {
+  World world(8, 8);
+  world.SetCell(-1, 0, World::CellType::kSand);
+  world.SetCell(8, 0, World::CellType::kSand);
+  EXPECT_EQ(world.GetSandCount(), 0);
+  EXPECT_EQ(world.GetCell(0, 8), World::CellType::kEmpty);
+}
+
+TEST(World, WallsBlockSandAndAreNotCounted) {
+  World world(8, 8);
+  world.SetCell(3, 4, World::CellType::kWall);
+  world.SetCell(3, 0, World::CellType::kSand);
+  EXPECT_EQ(world.GetSandCount(), 1);
+
+  // Overwriting sand with a wall removes it from the count.
+  world.SetCell(0, 0, World::CellType::kSand);
+  world.SetCell(0, 0, World::CellType::kWall);
+  EXPECT_EQ(world.GetSandCount(), 1);
+
+  for (uint32_t frame = 0; frame < 8; ++frame) {
+    world.Update(frame);
+  }
+  // The grain slid off the wall instead of passing through it.
+  EXPECT_EQ(world.GetCell(3, 4), World::CellType::kWall);
+  EXPECT_EQ(world.GetCell(3, 3), World::CellType::kEmpty);
+  EXPECT_EQ(world.GetSandCount(), 1);
+}
+
+TEST(World, UpdateReportsMovedCells) {
+  World world(8, 4);
+  world.SetCell(2, 0, World::CellType::kSand);
+  world.SetCell(5, 0, World::CellType::kSand);
+
+  EXPECT_EQ(world.Update(0), 2);
+  EXPECT_EQ(world.Update(1), 2);
+  EXPECT_EQ(world.Update(2), 2);
+  // Both grains rest on the floor now, the world is quiescent.
+  EXPECT_EQ(world.Update(3), 0);
+}
+
+TEST_P(WorldWidths, SkippingInactiveRegionsMatchesFullSteps) {
+  const int32_t width = GetParam();
+  for (auto layout : {World::Layout::kRows, World::Layout::kTiles}) {
+    World world(width, 200, layout);
+    World full(width, 200, layout);
+
+    // A sparse pile so some regions settle before the others.
+    for (int32_t y = 0; y < 200; ++y) {
+      for (int32_t x = 0; x < width; x += 1 + (x * 31 + y * 17) % 11) {
+        if ((x * 7 + y * 3) % 13 == 0) {
+          world.SetCell(x, y, World::CellType::kSand);
+          full.SetCell(x, y, World::CellType::kSand);
+        }
+      }
+    }
+
+    for (uint32_t frame = 0; frame < 250; ++frame) {
+      // Writing (nothing) marks every region active: a full step.
+      full.WriteCells(0, {});
+      ASSERT_EQ(world.Update(frame), full.Update(frame)) << frame;
+    }
+    for (int32_t y = 0; y < 200; ++y) {
+      for (int32_t x = 0; x < width; ++x) {
+        ASSERT_EQ(world.GetCell(x, y), full.GetCell(x, y)) << x << ", " << y;
+      }
+    }
+  }
+}
+
+TEST(World, TiledStepMovesGrainsIntoTheNextTileOnce) {
+  World world(200, 100, World::Layout::kTiles);
+  // Slides from the last column of the first tile (tile x is world x + 1)
+  // into the second tile, which runs afterwards.
+  world.SetCell(62, 10, World::CellType::kSand);
+  world.SetCell(62, 11, World::CellType::kWall);
+
+  EXPECT_EQ(world.Update(0), 1);
+  EXPECT_EQ(world.GetCell(63, 11), World::CellType::kSand);
+  EXPECT_EQ(world.GetSandCount(), 1);
+}
+
+TEST(World, TiledStepWakesTheTileItPassed) {
+  World world(200, 200, World::Layout::kTiles);
+  // A grain on the bottom line of the second tile (tile x is world x + 1)
+  // falls, its left neighbour above in the first tile was blocked by it.
+  world.SetCell(63, 62, World::CellType::kSand);
+  world.SetCell(62, 61, World::CellType::kSand);
+  world.SetCell(61, 62, World::CellType::kWall);
+  world.SetCell(62, 62, World::CellType::kWall);
+  // It lands right away, nothing else moves afterwards.
+  for (int32_t x = 62; x <= 64; ++x) {
+    world.SetCell(x, 64, World::CellType::kWall);
+  }
+
+  // The first tile ran before the grain fell.
+  world.Update(0);
+  EXPECT_EQ(world.GetCell(62, 61), World::CellType::kSand);
+  EXPECT_EQ(world.GetCell(63, 62), World::CellType::kEmpty);
+
+  // Its region is still examined in the next step.
+  world.Update(1);
+  EXPECT_EQ(world.GetCell(62, 61), World::CellType::kEmpty);
+  EXPECT_EQ(world.GetCell(63, 62), World::CellType::kSand);
+}
+
+TEST(World, RunToEquilibriumStopsOnceSettled) {
+  World world(100, 100);
+  for (int32_t x = 10; x < 90; ++x) {
+    world.SetCell(x, 0, World::CellType::kSand);
+  }
+
+  const World::SettleResult result = world.RunToEquilibrium();
+  EXPECT_TRUE(result.settled);
+  EXPECT_GE(result.steps, 100);
+  EXPECT_GE(result.moved_cells, 80 * 99);
+  EXPECT_EQ(world.GetSandCount(), 80);
+  EXPECT_EQ(world.GetActiveRegionCount(), 0);
+
+  // Nothing left to do.
+  EXPECT_EQ(world.RunToEquilibrium().steps, 1);
+}
+
+TEST(World, RunToEquilibriumRespectsStepLimit) {
+  World world(16, 100);
+  world.SetCell(8, 0, World::CellType::kSand);
+
+  World::SettleLimits limits;
+  limits.max_steps = 10;
+  const World::SettleResult result = world.RunToEquilibrium(limits);
+  EXPECT_FALSE(result.settled);
+  EXPECT_EQ(result.steps, 10);
+  EXPECT_EQ(result.moved_cells, 10);
+  EXPECT_GT(world.GetActiveRegionCount(), 0);
+}
+
+TEST_P(WorldWidths, RegionSandCountsStayInSync) {
+  const int32_t width = GetParam();
+  for (auto layout : {World::Layout::kRows, World::Layout::kTiles}) {
+    World world(width, 150, layout);
+    for (int32_t y = 0; y < 150; y += 2) {
+      for (int32_t x = 0; x < width; ++x) {
+        if ((x * 7 + y * 13) % 5 == 0) {
+          world.SetCell(x, y, World::CellType::kSand);
+        }
+      }
+    }
+    // Replace some of it (only sand is counted).
+    world.SetCell(0, 0, World::CellType::kWall);
+    world.SetCell(width - 1, 148, World::CellType::kEmpty);
+
+    for (uint32_t frame = 0; frame < 100; ++frame) {
+      world.Update(frame);
+    }
+    // Restoring raw cells keeps the counts too.
+    const std::vector<World::CellType> cells(world.GetCells().begin(),
+                                             world.GetCells().end());
+    World restored(width, 150, layout);
+    restored.WriteCells(0, cells);
+
+    for (const World* w : {&world, &restored}) {
+      uint64_t total = 0;
+      for (int32_t ry = 0; ry < w->GetRegionCountY(); ++ry) {
+        for (int32_t rx = 0; rx < w->GetRegionCountX(); ++rx) {
+          const World::Rect bounds = w->GetRegionBounds(rx, ry);
+          uint64_t sand = 0;
+          for (int32_t y = bounds.y; y < bounds.y + bounds.height; ++y) {
+            for (int32_t x = bounds.x; x < bounds.x + bounds.width; ++x) {
+              sand += w->GetCell(x, y) == World::CellType::kSand;
+            }
+          }
+          ASSERT_EQ(w->GetRegionSandCount(rx, ry), sand) << rx << ", " << ry;
+          total += sand;
+        }
+      }
+      EXPECT_EQ(total, w->GetSandCount());
+    }
+  }
+}
+
+TEST_P(WorldWidths, CountSandMatchesAScan) {
+  const int32_t width = GetParam();
+  World world(width, 140, World::Layout::kTiles);
+  for (int32_t y = 0; y < 140; ++y) {
+    for (int32_t x = 0; x < width; ++x) {
+      if ((x * 11 + y * 5) % 7 == 0) {
+        world.SetCell(x, y, World::CellType::kSand);
+      }
+    }
+  }
+
+  const World::Rect rects[] = {
+      {0, 0, width, 140},  {-10, -10, 5000, 5000}, {63, 63, 64, 64},
+      {5, 70, 130, 30},    {width - 3, 0, 10, 140}, {10, 10, 0, 5},
+      {width, 0, 10, 10},
+  };
+  for (const World::Rect& rect : rects) {
+    uint64_t expected = 0;
+    for (int32_t y = rect.y; y < rect.y + rect.height; ++y) {
+      for (int32_t x = rect.x; x < rect.x + rect.width; ++x) {
+        expected += world.GetCell(x, y) == World::CellType::kSand;
+      }
+    }
+    EXPECT_EQ(world.CountSand(rect), expected)
+        << rect.x << ", " << rect.y << ", " << rect.width << ", "
+        << rect.height;
+  }
+  EXPECT_EQ(world.CountSand({0, 0, width, 140}), world.GetSandCount());
+}
+
+TEST(World, DensityMapAndOccupiedRegions) {
+  World world(200, 100, World::Layout::kTiles);
+  EXPECT_EQ(world.GetRegionCountX(), 4);
+  EXPECT_EQ(world.GetRegionCountY(), 2);
+
+  // Regions are aligned to the world, the last ones are clipped.
+  const World::Rect first = world.GetRegionBounds(0, 0);
+  EXPECT_EQ(first.x, 0);
+  EXPECT_EQ(first.width, 64);
+  EXPECT_EQ(first.height, 64);
+  const World::Rect last = world.GetRegionBounds(3, 1);
+  EXPECT_EQ(last.x, 192);
+  EXPECT_EQ(last.width, 8);
+  EXPECT_EQ(last.height, 36);
+
+  // Fill the first region completely.
+  for (int32_t y = 0; y < 64; ++y) {
+    for (int32_t x = 0; x < 64; ++x) {
+      world.SetCell(x, y, World::CellType::kSand);
+    }
+  }
+  world.SetCell(150, 90, World::CellType::kSand);
+  world.SetCell(199, 99, World::CellType::kSand);
+
+  std::vector<float> map;
+  world.BuildDensityMap(&map);
+  ASSERT_EQ(map.size(), 8);
+  EXPECT_FLOAT_EQ(map[0], 1.0f);
+  EXPECT_FLOAT_EQ(map[1], 0.0f);
+  EXPECT_FLOAT_EQ(map[7], 1.0f / (8 * 36));
+
+  int32_t occupied = 0;
+  world.ForEachOccupiedRegion([&](int32_t rx, int32_t ry, uint32_t count) {
+    EXPECT_FALSE(world.IsRegionEmpty(rx, ry));
+    EXPECT_EQ(count, rx == 0 ? 64 * 64 : 1);
+    occupied++;
+  });
+  EXPECT_EQ(occupied, 3);
+  EXPECT_TRUE(world.IsRegionEmpty(1, 0));
+  EXPECT_TRUE(world.IsRegionEmpty(-1, 0));
+
+  // Region aligned rectangles only read the counters.
+  EXPECT_EQ(world.CountSand({0, 0, 64, 64}), 64 * 64);
+  EXPECT_EQ(world.CountSand({128, 64, 72, 36}), 2);
+}
+
+TEST(World, TracksDirtyRegions) {
+  for (auto layout : {World::Layout::kRows, World::Layout::kTiles}) {
+    World world(300, 200, layout);
+    const size_t size = world.GetCells().size();
+    // Everything is dirty until a consumer has seen it.
+    EXPECT_TRUE(world.IsDirty(0, size));
+    world.ClearDirty();
+    EXPECT_FALSE(world.IsDirty(0, size));
+
+    // Settled sand changes nothing.
+    world.SetCell(150, 199, World::CellType::kSand);
+    EXPECT_TRUE(world.IsDirty(0, size));
+    world.ClearDirty();
+    world.Update(0);
+    EXPECT_FALSE(world.IsDirty(0, size));
+
+    // A falling grain dirties its cells, far away cells stay clean.
+    world.SetCell(10, 0, World::CellType::kSand);
+    world.ClearDirty();
+    world.Update(1);
+    EXPECT_TRUE(world.IsDirty(0, size));
+    EXPECT_FALSE(world.IsDirty(size - 64, 64));
+  }
+}
+
+TEST_P(WorldWidths, WriteCellsKeepsTheBorder) {
+  const int32_t width = GetParam();
+  for (auto layout : {World::Layout::kRows, World::Layout::kTiles}) {
+    World world(width, 70, layout);
+    const std::vector<World::CellType> walls(world.GetCells().begin(),
+                                             world.GetCells().end());
+
+    // Fill everything with sand (border and padding included).
+    const std::vector<World::CellType> sand(walls.size(),
+                                            World::CellType::kSand);
+    world.WriteCells(0, sand);
+    EXPECT_EQ(world.GetSandCount(), uint64_t(width) * 70);
+
+    // Clear everything, only the cells inside the world change.
+    const std::vector<World::CellType> empty(walls.size(),
+                                             World::CellType::kEmpty);
+    world.WriteCells(0, empty);
+    EXPECT_EQ(world.GetSandCount(), 0);
+    for (size_t i = 0; i < walls.size(); ++i) {
+      if (walls[i] == World::CellType::kWall) {
+        ASSERT_EQ(world.GetCells()[i], World::CellType::kWall) << i;
+      }
+    }
+
+    // Sand still lands on the floor.
+    world.SetCell(width / 2, 0, World::CellType::kSand);
+    world.RunToEquilibrium();
+    EXPECT_EQ(world.GetCell(width / 2, 69), World::CellType::kSand);
+    EXPECT_EQ(world.GetSandCount(), 1);
+  }
+}